@@ -0,0 +1,558 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <limits>
+#include <tuple>
+#include "multi_idx/perm.hpp"
+#include "sdsl/io.hpp"
+#include "sdsl/int_vector.hpp"
+#include "sdsl/bit_vectors.hpp"
+#include "multi_idx/mappable_bit_vector.hpp"
+#include "multi_idx/multi_idx_helper.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
+#include "multi_idx/mmap_io.hpp"
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+
+  /*! Hybrid of the split strategies which chooses the layout of each bucket
+   *  from its size at build time:
+   *   - flat:        at most small_bucket_size keys; scanned like
+   *                  simple_buckets_binvector_split.
+   *   - clustered:   at most large_bucket_size keys; partitioned into pivot
+   *                  clusters like triangle_clusters_binvector_split_threshold,
+   *                  so clusters out of reach of the query are skipped.
+   *   - sub_indexed: larger buckets are sorted by the sub_bits bits below
+   *                  the splitter bits. A query only scans the sub-buckets
+   *                  within its error budget on these bits. sub_bits grows
+   *                  with the bucket size, so that a sub-bucket holds about
+   *                  sub_bucket_size keys.
+   *  Skewed data, where a few buckets hold most keys, so costs at most
+   *  a bounded number of entries per bucket instead of a scan of the
+   *  largest bucket.
+   *
+   *  \par The layout is a function of the bucket size, so it is not stored.
+   *       Clustered and sub-indexed buckets have an entry in a directory,
+   *       which is located by a binary search over their bucket ids.
+   */
+  template<uint8_t t_b=4,
+           uint8_t t_k=3,
+           size_t t_id=0,
+           typename perm_b_k=perm<t_b,t_b-t_k>,
+           uint16_t small_bucket_size=64,
+           uint16_t large_bucket_size=2048,
+           uint8_t sub_bucket_size=16,
+           typename t_bv=mappable_bit_vector,
+           typename t_sel=typename t_bv::select_1_type>
+  class _adaptive_buckets_binvector_split {
+    public:
+        typedef uint64_t size_type;
+        typedef uint64_t entry_type;
+        typedef perm_b_k perm;
+        enum {id = t_id};
+        enum bucket_layout {flat, clustered, sub_indexed};
+
+        friend std::map<uint64_t,uint64_t> get_bucket_dist<_adaptive_buckets_binvector_split>(const _adaptive_buckets_binvector_split&);
+    private:
+        static constexpr uint8_t init_splitter_bits(size_t i=0){
+            return i < perm_b_k::match_len ? perm_b_k::mi_permute_block_widths[t_id][t_b-1-i] + init_splitter_bits(i+1) : 0;
+        }
+
+        /* Low_* stuff control how many of the less signifigant bits form the lower part */
+        static constexpr uint8_t    low_bits    = 32; // PLS, keep this a power of 2, better if word aligned
+        static constexpr uint64_t   low_mask    = (1ULL<<low_bits)-1;
+    public:
+        static constexpr uint8_t    splitter_bits = init_splitter_bits(0);
+    private:
+        static constexpr uint8_t    mid_bits = 64 - (low_bits + splitter_bits);
+        static constexpr uint8_t    mid_shift   = low_bits;
+        static constexpr uint64_t   mid_mask = (1ULL<<mid_bits)-1;
+        static constexpr uint8_t    high_shift = (64-splitter_bits);
+        static constexpr uint8_t    max_sub_bits = mid_bits < 16 ? mid_bits : 16;
+        using  mid_entries_type = typename mid_entries_trait<mid_bits>::type;
+
+        uint64_t                    m_n;      // number of items
+        mappable_int_vector<low_bits> m_low_entries;
+        mid_entries_type            m_mid_entries;
+        t_bv                        m_C;     // bit vector for prefix sums of meta-symbols
+        t_sel                       m_C_sel; // select1 structure for m_C
+        mappable_int_vector<64>     m_dir_buckets; // sorted ids of the clustered and sub-indexed buckets
+        mappable_int_vector<64>     m_dir_offsets; // start of their entry in m_dir
+        /* Directory entry of a clustered bucket: c, then c triples (start, pivot, radius).
+           Of a sub-indexed bucket: sub_bits, then 2^sub_bits+1 sub-bucket borders. */
+        mappable_int_vector<64>     m_dir;
+        payload_vector              m_payloads; // payloads in the order of the entries
+
+    public:
+        _adaptive_buckets_binvector_split() = default;
+
+        _adaptive_buckets_binvector_split(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+            _adaptive_buckets_binvector_split(key_source(input_entries, payloads), pool) {}
+
+        //! Builds the index from keys in memory or streamed from a file
+        _adaptive_buckets_binvector_split(const key_source &input_entries, thread_pool* pool=nullptr) {
+            std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl;
+            m_n = input_entries.size();
+            m_low_entries = sdsl::int_vector<low_bits>(input_entries.size(), 0);
+            m_mid_entries = mid_entries_trait<mid_bits>::get_instance(input_entries.size(), 0);
+            m_payloads = payload_vector(input_entries);
+            build_small_universe(input_entries, pool);
+        }
+
+        //! Layout of a bucket with size keys
+        static bucket_layout layout(const uint64_t size) {
+            return size <= small_bucket_size ? flat : (size <= large_bucket_size ? clustered : sub_indexed);
+        }
+
+        //! Number of sub-key bits of a sub-indexed bucket with size keys
+        static uint8_t sub_bits(const uint64_t size) {
+            uint8_t s = 0;
+            while ( s < max_sub_bits and (size >> s) > sub_bucket_size ) ++s;
+            return s;
+        }
+
+        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
+
+            std::vector<entry_type> res;
+            if(find_only_candidates) return {res, r-l};
+
+            const uint64_t candidates = scan(q, errors, bucket, l, r, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
+            return {res, candidates};
+        }
+
+        /*! Calls report(x, i) for all entries x within distance errors of q in the
+         *  bucket of q, where i is the position of x in the entry arrays. Stops
+         *  as soon as report returns false. Entries are reported as they are
+         *  stored, i.e. without applying the reverse permutation (see get_key).
+         *  \return The number of candidates like match.
+         */
+        template<typename t_report>
+        uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
+            return scan(q, errors, bucket, l, r, report);
+        }
+
+        /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+         *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+         *  with radius - popcount(masks[j]) errors. The bucket ranges of a chunk
+         *  of sub-queries are located together, see visit_bucket_masks.
+         *  Stops as soon as report returns false.
+         *  \return The number of candidates of all sub-queries.
+         */
+        template<typename t_report>
+        uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+            return visit_bucket_masks(m_C, m_C_sel, q_permuted, masks, n, radius,
+                [](uint64_t x) { return perm_b_k::template rev_permute<t_id>(x); },
+                [&](uint64_t q) { return get_bucket_id(q); },
+                [&](uint64_t q, uint8_t errors, uint64_t bucket, uint64_t l, uint64_t r, auto&& rep) { return scan(q, errors, bucket, l, r, rep); },
+                report);
+        }
+
+        /*! Calls report(x, i) like visit for all entries, bucket by bucket, e.g.
+         *  for a linear scan. Stops as soon as report returns false.
+         */
+        template<typename t_report>
+        void visit_all(t_report&& report) const {
+            bool go_on = true;
+            for_each_bucket(m_C, m_C_sel, 1ULL << splitter_bits, [&](uint64_t bucket, uint64_t l, uint64_t r) {
+                const uint64_t q = perm_b_k::template rev_permute<t_id>(bucket << (64-splitter_bits));
+                scan(q, 64, bucket, l, r, [&](uint64_t x, uint64_t i) { return go_on = report(x, i); });
+                return go_on;
+            });
+        }
+
+        //! Key of an entry x reported by visit
+        static uint64_t get_key(const uint64_t x) {
+            return perm_b_k::template rev_permute<t_id>(x);
+        }
+
+        //! Key of an entry x reported by visit under the permutation of this index
+        static uint64_t get_permuted_key(const uint64_t x) {
+            return x;
+        }
+
+        //! Matches a batch of (sub-)queries which is sorted by bucket
+        template<typename t_sink>
+        void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            while ( first != last ) {
+                const uint64_t bucket = first->bucket;
+                const auto range = bucket_range(m_C, m_C_sel, bucket);
+                const auto l = range.first;
+                const auto r = range.second;
+                for (; first != last and first->bucket == bucket; ++first) {
+                    const uint32_t qid = first->id;
+                    if ( find_only_candidates ) {
+                        sink.add_candidates(qid, r-l);
+                    } else {
+                        sink.add_candidates(qid, scan(first->key, first->errors, bucket, l, r, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; }));
+                    }
+                }
+            }
+        }
+
+    private:
+        // Scans the bucket [l, r) according to its layout and reports all keys within
+        // distance errors of q as report(entry, position of the entry in the entry
+        // arrays), see get_key. Stops as soon as report returns false.
+        // Returns the number of checked candidates.
+        template<typename t_report>
+        inline uint64_t scan(const entry_type q, uint8_t errors, const uint64_t bucket, const uint64_t l, const uint64_t r, t_report&& report) const {
+            const uint64_t q_permuted = perm_b_k::template permute<t_id>(q);
+            scan_stats stats(0);
+            switch ( layout(r-l) ) {
+                case flat:
+                    scan_range(q_permuted, errors, l, r, stats, report);
+                    return r-l;
+                case clustered:
+                    return scan_clusters(q_permuted, errors, dir_entry(bucket), r, stats, report);
+                default:
+                    return scan_sub_buckets(q_permuted, errors, dir_entry(bucket), l, r, stats, report);
+            }
+        }
+
+        // Offset of the directory entry of a clustered or sub-indexed bucket
+        uint64_t dir_entry(const uint64_t bucket) const {
+            const auto it = std::lower_bound(m_dir_buckets.begin(), m_dir_buckets.end(), bucket);
+            return m_dir_offsets[it - m_dir_buckets.begin()];
+        }
+
+        // Scans the entries in [l, r); returns false if report stopped the scan
+        template<typename t_report>
+        inline bool scan_range(const uint64_t q_permuted, uint8_t errors, const uint64_t l, const uint64_t r, scan_stats& stats, t_report&& report) const {
+            const uint64_t q_high = (q_permuted>>(high_shift))<<high_shift;
+            const uint64_t q_low  = q_permuted & low_mask;
+            const auto begin = m_low_entries.begin() + l;
+            stats.candidates(r-l);
+            return filter_low_entries(begin, r-l, q_low, errors, [&](size_t i) {
+                stats.prefiltered();
+                const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l+i]) << mid_shift) | begin[i];
+                if (sdsl::bits::cnt(q_permuted^curr_el) <= errors) {
+                    stats.verified();
+                    return report(curr_el, l+i);
+                }
+                return true;
+            });
+        }
+
+        // Scans the pivot clusters of a bucket which ends at r and which are in reach of the query
+        template<typename t_report>
+        inline uint64_t scan_clusters(const uint64_t q_permuted, uint8_t errors, const uint64_t dir, const uint64_t r, scan_stats& stats, t_report&& report) const {
+            const uint64_t clusters = m_dir[dir];
+            uint64_t candidates = 0;
+            for (uint64_t c = 0, p = dir+1; c < clusters; ++c, p += 3) {
+                const uint64_t pivot  = m_dir[p+1];
+                const uint64_t radius = m_dir[p+2];
+                const uint64_t dist   = sdsl::bits::cnt(pivot^q_permuted);
+                if ( dist <= radius+errors ) {
+                    const uint64_t pos_l = m_dir[p];
+                    const uint64_t pos_r = c+1 < clusters ? m_dir[p+3] : r;
+                    stats.cluster_visited();
+                    candidates += pos_r-pos_l;
+                    if ( !scan_range(q_permuted, errors, pos_l, pos_r, stats, report) ) return candidates;
+                    // All keys within errors of the query are within radius of the pivot
+                    if ( radius >= errors and dist <= radius-errors ) {
+                        stats.early_exit();
+                        break;
+                    }
+                } else {
+                    stats.cluster_skipped();
+                }
+            }
+            return candidates;
+        }
+
+        // Scans the sub-buckets of [l, r) whose sub-key is within distance errors of the query
+        template<typename t_report>
+        inline uint64_t scan_sub_buckets(const uint64_t q_permuted, uint8_t errors, const uint64_t dir, const uint64_t l, const uint64_t r, scan_stats& stats, t_report&& report) const {
+            const uint8_t s = m_dir[dir];
+            // Probing the ball costs more than a flat scan if it covers most sub-buckets
+            uint64_t ball = 0;
+            uint64_t binom = 1;
+            for (uint8_t e = 0; e <= std::min(errors, s); ++e) {
+                ball += binom;
+                binom = binom * (s-e) / (e+1);
+            }
+            if ( 2*ball > (1ULL << s) ) {
+                scan_range(q_permuted, errors, l, r, stats, report);
+                return r-l;
+            }
+            const uint64_t q_sub = (q_permuted >> (high_shift-s)) & ((1ULL << s)-1);
+            uint64_t candidates = 0;
+            probe_ball(q_sub, s, 0, errors, [&](uint64_t sub) {
+                const uint64_t pos_l = m_dir[dir+1+sub];
+                const uint64_t pos_r = m_dir[dir+2+sub];
+                if ( pos_l == pos_r ) return true;
+                stats.cluster_visited();
+                candidates += pos_r-pos_l;
+                return scan_range(q_permuted, errors, pos_l, pos_r, stats, report);
+            });
+            return candidates;
+        }
+
+        // Calls f(x) for all x which differ from sub in at most errors of the bits [0, s) starting at bit first
+        template<typename t_f>
+        static bool probe_ball(const uint64_t sub, const uint8_t s, const uint8_t first, const uint8_t errors, t_f&& f) {
+            if ( !f(sub) ) return false;
+            if ( errors == 0 ) return true;
+            for (uint8_t j = first; j < s; ++j) {
+                if ( !probe_ball(sub ^ (1ULL << j), s, j+1, errors-1, f) ) return false;
+            }
+            return true;
+        }
+
+    public:
+        _adaptive_buckets_binvector_split& operator=(const _adaptive_buckets_binvector_split& idx) {
+            if ( this != &idx ) {
+                m_n           = idx.m_n;
+                m_payloads    = idx.m_payloads;
+                m_low_entries = idx.m_low_entries;
+                m_mid_entries = idx.m_mid_entries;
+                m_dir_buckets = idx.m_dir_buckets;
+                m_dir_offsets = idx.m_dir_offsets;
+                m_dir         = idx.m_dir;
+                m_C           = idx.m_C;
+                m_C_sel       = idx.m_C_sel;
+                m_C_sel.set_vector(&m_C);
+            }
+            return *this;
+        }
+
+        _adaptive_buckets_binvector_split& operator=(_adaptive_buckets_binvector_split&& idx) {
+            if ( this != &idx ) {
+                m_n           = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
+                m_low_entries = std::move(idx.m_low_entries);
+                m_mid_entries = std::move(idx.m_mid_entries);
+                m_dir_buckets = std::move(idx.m_dir_buckets);
+                m_dir_offsets = std::move(idx.m_dir_offsets);
+                m_dir         = std::move(idx.m_dir);
+                m_C           = std::move(idx.m_C);
+                m_C_sel       = std::move(idx.m_C_sel);
+                m_C_sel.set_vector(&m_C);
+            }
+            return *this;
+        }
+
+        _adaptive_buckets_binvector_split(const _adaptive_buckets_binvector_split& idx) {
+            *this = idx;
+        }
+
+        _adaptive_buckets_binvector_split(_adaptive_buckets_binvector_split&& idx){
+            *this = std::move(idx);
+        }
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream& out, sdsl::structure_tree_node* v=nullptr, std::string name="")const {
+            using namespace sdsl;
+            structure_tree_node* child = structure_tree::add_child(v, name, util::class_name(*this));
+            uint64_t written_bytes = 0;
+            written_bytes += write_member(m_n, out, child, "n");
+            written_bytes += m_low_entries.serialize(out, child, "low_entries");
+            written_bytes += m_mid_entries.serialize(out, child, "mid_entries");
+            written_bytes += m_C.serialize(out, child, "C");
+            written_bytes += m_C_sel.serialize(out, child, "C_sel");
+            written_bytes += m_dir_buckets.serialize(out, child, "dir_buckets");
+            written_bytes += m_dir_offsets.serialize(out, child, "dir_offsets");
+            written_bytes += m_dir.serialize(out, child, "dir");
+            written_bytes += m_payloads.serialize(out, child, "payloads");
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        //! Loads the data structure from the given istream.
+        void load(std::istream& in) {
+            using namespace sdsl;
+            read_member(m_n, in);
+            m_low_entries.load(in);
+            m_mid_entries.load(in);
+            m_C.load(in);
+            m_C_sel.load(in, &m_C);
+            m_dir_buckets.load(in);
+            m_dir_offsets.load(in);
+            m_dir.load(in);
+            m_payloads.load(in);
+        }
+
+        size_type size() const{
+            return m_n;
+        }
+
+        //! True if the entries and the bucket directory live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            return m_low_entries.is_mapped() and m_C.is_mapped();
+        }
+
+public:
+
+    inline uint64_t get_bucket_id(const uint64_t x) const {
+        return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits);
+    }
+
+private:
+
+    // Directory entries of a part of the buckets; offsets are relative to dir
+    struct directory_part {
+        std::vector<uint64_t> buckets;
+        std::vector<uint64_t> offsets;
+        std::vector<uint64_t> dir;
+    };
+
+    void build_small_universe(const key_source &input_entries, thread_pool* pool) {
+        uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
+
+        // keys are permuted, so the bucket of keys[j] is keys[j] >> high_shift
+        std::vector<uint64_t> keys(input_entries.size(), 0);
+        // payloads[j] belongs to keys[j] and is moved along with it
+        std::vector<uint64_t> payloads(m_payloads.empty() ? 0 : input_entries.size());
+        const std::vector<uint64_t> bucket_sizes = bucket_scatter(input_entries, splitter_universe,
+            [&](uint64_t x) { return get_bucket_id(x); },
+            [&](uint64_t j, uint64_t x, uint64_t payload) {
+                keys[j] = perm_b_k::template permute<t_id>(x);
+                if ( !payloads.empty() ) payloads[j] = payload;
+            }, pool); // includes a sentinel
+
+        // Buckets are laid out independently, so the parts are built in
+        // parallel and concatenated in order
+        std::vector<size_t> borders = run_borders(keys, pool == nullptr ? 1 : 4*pool->size(), [](uint64_t x) { return x >> high_shift; });
+        std::vector<directory_part> parts(borders.size()-1);
+        auto layout_parts = [&](size_t begin, size_t end, size_t) {
+            for (size_t p = begin; p < end; ++p) {
+                layout_buckets(keys, payloads, borders[p], borders[p+1], parts[p]);
+            }
+        };
+        if ( pool != nullptr ) {
+            pool->parallel_for(parts.size(), 1, layout_parts);
+        } else {
+            layout_parts(0, parts.size(), 0);
+        }
+
+        size_t dir_buckets = 0, dir_size = 0;
+        for (const auto& part : parts) {
+            dir_buckets += part.buckets.size();
+            dir_size += part.dir.size();
+        }
+        m_dir_buckets = sdsl::int_vector<64>(dir_buckets, 0);
+        m_dir_offsets = sdsl::int_vector<64>(dir_buckets, 0);
+        m_dir = sdsl::int_vector<64>(dir_size, 0);
+        size_t b = 0, d = 0;
+        for (const auto& part : parts) {
+            for (size_t i = 0; i < part.buckets.size(); ++i, ++b) {
+                m_dir_buckets[b] = part.buckets[i];
+                m_dir_offsets[b] = d + part.offsets[i];
+            }
+            for (auto x : part.dir) m_dir[d++] = x;
+        }
+
+        parallel_ranges(pool, keys.size(), [&](size_t begin, size_t end) {
+            for(size_t k = begin; k < end; ++k) {
+                mid_entries_trait<mid_bits>::assign(m_mid_entries, k, (keys[k]>>mid_shift) & mid_mask);
+                m_low_entries[k] = keys[k] & low_mask;
+            }
+        });
+        for (size_t k = 0; k < payloads.size(); ++k) {
+            m_payloads.set(k, payloads[k]);
+        }
+
+        m_C = t_bv(bucket_sizes.size()+input_entries.size(), 0);
+        size_t idx = 0;
+        for(auto x : bucket_sizes) {
+          idx += x;
+          m_C[idx++] = 1;
+        }
+        m_C_sel = t_sel(&m_C);
+    }
+
+    /*! Lays out the buckets in keys[first, last) and appends the directory
+     *  entries of the clustered and sub-indexed ones to part. first and last
+     *  are bucket borders; the result only depends on the keys in the range.
+     *  payloads is empty or reordered like keys.
+     */
+    void layout_buckets(std::vector<uint64_t>& keys, std::vector<uint64_t>& payloads, size_t first, size_t last,
+                        directory_part& part) {
+        for (size_t start = first, end; start < last; start = end) {
+            const uint64_t bucket = keys[start] >> high_shift;
+            end = start;
+            while ( end < last and (keys[end] >> high_shift) == bucket ) ++end;
+            const bucket_layout lay = layout(end-start);
+            if ( lay == flat ) continue;
+            part.buckets.push_back(bucket);
+            part.offsets.push_back(part.dir.size());
+            if ( lay == clustered ) {
+                cluster_bucket(keys, payloads, start, end, part.dir);
+            } else {
+                sub_index_bucket(keys, payloads, start, end, part.dir);
+            }
+        }
+    }
+
+    // Greedily partitions [start, end) into clusters of at least small_bucket_size keys around a pivot
+    void cluster_bucket(std::vector<uint64_t>& keys, std::vector<uint64_t>& payloads, size_t start, size_t end, std::vector<uint64_t>& dir) {
+        const size_t count_pos = dir.size();
+        dir.push_back(0);
+        std::vector<uint64_t> counts(65, 0);
+        for (size_t next = start; next < end; ) {
+            const uint64_t pivot = keys[next];
+            std::fill(counts.begin(), counts.end(), 0);
+            for (size_t i = next; i < end; ++i) {
+                ++counts[sdsl::bits::cnt(pivot^keys[i])];
+            }
+            uint64_t radius = 0;
+            for (uint64_t sum = counts[0]; sum < small_bucket_size and radius < 64; sum += counts[++radius]) {}
+            dir.push_back(next);
+            dir.push_back(pivot);
+            dir.push_back(radius);
+            ++dir[count_pos];
+            // moves the keys of the cluster to the front, along with their payloads
+            for (size_t i = next, j = next; i < end; ++i) {
+                if ( sdsl::bits::cnt(pivot^keys[i]) <= radius ) {
+                    std::swap(keys[i], keys[j]);
+                    if ( !payloads.empty() ) std::swap(payloads[i], payloads[j]);
+                    next = ++j;
+                }
+            }
+        }
+    }
+
+    // Sorts [start, end) by the bits below the splitter bits and stores the sub-bucket borders
+    void sub_index_bucket(std::vector<uint64_t>& keys, std::vector<uint64_t>& payloads, size_t start, size_t end, std::vector<uint64_t>& dir) {
+        const uint8_t s = sub_bits(end-start);
+        if ( payloads.empty() ) {
+            std::sort(keys.begin()+start, keys.begin()+end);
+        } else {
+            std::vector<std::pair<uint64_t,uint64_t>> entries(end-start);
+            for (size_t i = start; i < end; ++i) entries[i-start] = {keys[i], payloads[i]};
+            std::sort(entries.begin(), entries.end());
+            for (size_t i = start; i < end; ++i) std::tie(keys[i], payloads[i]) = entries[i-start];
+        }
+        dir.push_back(s);
+        size_t pos = start;
+        for (uint64_t sub = 0; sub < (1ULL << s); ++sub) {
+            dir.push_back(pos);
+            while ( pos < end and ((keys[pos] >> (high_shift-s)) & ((1ULL << s)-1)) == sub ) ++pos;
+        }
+        dir.push_back(end);
+    }
+};
+
+template<uint16_t small_bucket_size=64,
+         uint16_t large_bucket_size=2048,
+         uint8_t sub_bucket_size=16,
+         typename t_bv=mappable_bit_vector,
+         typename t_sel=typename t_bv::select_1_type>
+struct adaptive_buckets_binvector_split {
+    template<uint8_t t_b, uint8_t t_k, size_t t_id, typename t_perm>
+    using type = _adaptive_buckets_binvector_split<t_b, t_k, t_id, t_perm, small_bucket_size, large_bucket_size, sub_bucket_size, t_bv, t_sel>;
+};
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include "sdsl/int_vector.hpp"
+
+namespace multi_index {
+
+/*! Bucket directories of the binvector strategies.
+ *
+ *  m_C has a 0 per entry and a 1 behind each bucket, so the entries of
+ *  bucket b are [l, r) with l = select_1(b)-b+1 (0 for b = 0) and
+ *  r = select_1(b+1)-b. Both ones are usually close, since a bucket holds
+ *  few entries. The functions below therefore find the first one with a
+ *  select and the second one by scanning the words behind it, and only
+ *  fall back to a second select for a bucket which spans more than
+ *  bucket_scan_words words.
+ */
+static constexpr uint64_t bucket_scan_words = 8; // one cache line
+
+namespace bucket_range_detail {
+
+// Position of the cnt-th one (cnt >= 1) at or after pos, if it is in the
+// bucket_scan_words words from pos; otherwise ~0ULL
+template<typename t_bv>
+inline uint64_t next_one(const t_bv& C, const uint64_t pos, uint64_t cnt) {
+    const uint64_t* data = C.data();
+    const uint64_t words = (C.size()+63) >> 6;
+    uint64_t w = pos >> 6;
+    uint64_t word = data[w] & (~0ULL << (pos & 63));
+    for (uint64_t i = 0; ; ) {
+        const uint64_t c = sdsl::bits::cnt(word);
+        if ( cnt <= c ) return (w << 6) + sdsl::bits::sel(word, cnt);
+        cnt -= c;
+        if ( ++i == bucket_scan_words or ++w == words ) return ~0ULL;
+        word = data[w];
+    }
+}
+
+}
+
+/*! Entries [l, r) of bucket, i.e. the zeros between the bucket-th one
+ *  (bucket > 0) and the next one of C, with one select on C_sel.
+ */
+template<typename t_bv, typename t_sel>
+inline std::pair<uint64_t, uint64_t> bucket_range(const t_bv& C, const t_sel& C_sel, const uint64_t bucket) {
+    const uint64_t begin = bucket == 0 ? 0 : C_sel(bucket)+1;
+    uint64_t end = bucket_range_detail::next_one(C, begin, 1);
+    if ( end == ~0ULL ) end = C_sel(bucket+1);
+    return {begin - bucket, end - bucket};
+}
+
+//! Entries [l, r) of the buckets first..last (first <= last), e.g. the buckets of the cardinalities of a key
+template<typename t_bv, typename t_sel>
+inline std::pair<uint64_t, uint64_t> bucket_range(const t_bv& C, const t_sel& C_sel, const uint64_t first, const uint64_t last) {
+    const uint64_t begin = first == 0 ? 0 : C_sel(first)+1;
+    uint64_t end = bucket_range_detail::next_one(C, begin, last-first+1);
+    if ( end == ~0ULL ) end = C_sel(last+1);
+    return {begin - first, end - last};
+}
+
+/*! Entries of n buckets: ranges[j] = bucket_range(C, C_sel, buckets[j]).
+ *  \par All directory lookups are done before any bucket is scanned and
+ *       are independent of each other, so their cache misses overlap.
+ *       Equal consecutive buckets are looked up once.
+ */
+template<typename t_bv, typename t_sel>
+inline void bucket_ranges(const t_bv& C, const t_sel& C_sel, const uint64_t* buckets, const size_t n, std::pair<uint64_t, uint64_t>* ranges) {
+    for (size_t j = 0; j < n; ++j) {
+        ranges[j] = (j > 0 and buckets[j] == buckets[j-1]) ? ranges[j-1] : bucket_range(C, C_sel, buckets[j]);
+    }
+}
+
+/*! Calls f(bucket, l, r) for the non-empty buckets among the first
+ *  buckets in increasing order, e.g. for a linear scan of all entries.
+ *  Stops as soon as f returns false.
+ *  \par The entries are visited in order. The bucket of the next entry is
+ *       found with a galloping search over the bucket starts, so B
+ *       non-empty buckets cost O(B log(buckets/B)) lookups instead of one
+ *       per bucket, which matters when buckets vastly outnumber entries.
+ */
+template<typename t_bv, typename t_sel, typename t_f>
+inline void for_each_bucket(const t_bv& C, const t_sel& C_sel, const uint64_t buckets, t_f&& f) {
+    if ( buckets == 0 ) return;
+    const uint64_t n = bucket_range(C, C_sel, buckets-1).second;
+    auto start = [&](uint64_t b) { return bucket_range(C, C_sel, b).first; };
+    for (uint64_t i = 0, bucket = 0; i < n; ) {
+        // the last bucket which starts at or before entry i holds it
+        uint64_t step = 1, hi = bucket+1;
+        while ( hi < buckets and start(hi) <= i ) {
+            bucket = hi;
+            step *= 2;
+            hi = bucket+step;
+        }
+        hi = std::min(hi, buckets);
+        while ( hi - bucket > 1 ) {
+            const uint64_t mid = bucket + (hi-bucket)/2;
+            if ( start(mid) <= i ) bucket = mid; else hi = mid;
+        }
+        const auto range = bucket_range(C, C_sel, bucket);
+        if ( !f(bucket, range.first, range.second) ) return;
+        i = range.second;
+        ++bucket;
+    }
+}
+
+static constexpr size_t mask_chunk = 32; // sub-queries whose bucket ranges are located together
+
+/*! Common part of visit_masks of the strategy classes with a bucket
+ *  directory. Sub-query j is rev_permute(q_permuted ^ masks[j]) with
+ *  radius - popcount(masks[j]) errors (see multi_idx_red). The bucket
+ *  ranges of up to mask_chunk sub-queries are located with bucket_ranges,
+ *  then their buckets are scanned in order of j.
+ *  \param rev_permute Maps a key of the permutation to the original key.
+ *  \param bucket_id   Bucket of an original key.
+ *  \param scan        scan(key, errors, bucket, l, r, report) reports the
+ *                     entries within distance errors of key in [l, r).
+ *  \param report      report(x, i, j) for each match x at position i of
+ *                     sub-query j; stops as soon as it returns false.
+ *  \return The number of candidates of all sub-queries.
+ */
+template<typename t_bv, typename t_sel, typename t_rev_permute, typename t_bucket_id, typename t_scan, typename t_report>
+inline uint64_t visit_bucket_masks(const t_bv& C, const t_sel& C_sel, const uint64_t q_permuted, const uint64_t* masks, const size_t n,
+                                   const uint8_t radius, t_rev_permute&& rev_permute, t_bucket_id&& bucket_id, t_scan&& scan, t_report&& report) {
+    std::array<uint64_t, mask_chunk> keys, buckets;
+    std::array<std::pair<uint64_t, uint64_t>, mask_chunk> ranges;
+    uint64_t candidates = 0;
+    bool go_on = true;
+    for (size_t c = 0; c < n and go_on; c += mask_chunk) {
+        const size_t m = std::min(mask_chunk, n-c);
+        for (size_t j = 0; j < m; ++j) {
+            keys[j] = rev_permute(q_permuted ^ masks[c+j]);
+            buckets[j] = bucket_id(keys[j]);
+        }
+        bucket_ranges(C, C_sel, buckets.data(), m, ranges.data());
+        for (size_t j = 0; j < m and go_on; ++j) {
+            const uint8_t errors = radius - sdsl::bits::cnt(masks[c+j]);
+            candidates += scan(keys[j], errors, buckets[j], ranges[j].first, ranges[j].second, [&](uint64_t x, uint64_t i) {
+                return go_on = report(x, i, c+j);
+            });
+        }
+    }
+    return candidates;
+}
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "multi_idx/key_source.hpp"
+#include "multi_idx/thread_pool.hpp"
+
+namespace multi_index {
+
+/*! Calls f(begin, end) for consecutive ranges of [0, n), in parallel if a
+ *  pool is given. Range borders are multiples of 64, so that threads can
+ *  write disjoint ranges of a bit-compressed int_vector of any width.
+ */
+template<typename t_f>
+void parallel_ranges(thread_pool* pool, size_t n, t_f&& f) {
+    if ( n == 0 ) return;
+    if ( pool == nullptr or pool->size() == 1 ) {
+        f(0, n);
+        return;
+    }
+    size_t grain = std::max((size_t)1<<16, n/(4*pool->size()));
+    grain = (grain+63)/64*64;
+    pool->parallel_for(n, grain, [&](size_t begin, size_t end, size_t) { f(begin, end); });
+}
+
+/*! Splits [0, items.size()) into at most parts ranges of similar size without
+ *  splitting a run of items with equal id(item) (e.g. a bucket). Range p is
+ *  [borders[p], borders[p+1]); the result only depends on the ids and parts.
+ */
+template<typename t_item, typename t_id_of>
+std::vector<size_t> run_borders(const std::vector<t_item>& items, size_t parts, t_id_of&& id) {
+    std::vector<size_t> borders{0};
+    const size_t n = items.size();
+    for (size_t p=1; p < parts; ++p) {
+        size_t pos = std::max(borders.back(), n/parts*p);
+        while ( pos > 0 and pos < n and id(items[pos]) == id(items[pos-1]) ) ++pos;
+        if ( pos > borders.back() and pos < n ) borders.push_back(pos);
+    }
+    borders.push_back(n);
+    return borders;
+}
+
+//! run_borders of a vector of ids
+template<typename t_id>
+std::vector<size_t> run_borders(const std::vector<t_id>& ids, size_t parts) {
+    return run_borders(ids, parts, [](const t_id& x) { return x; });
+}
+
+/*! Stable counting sort of the items [0, n) by bucket(i) in [0, universe).
+ *
+ *  \par The items are split into contiguous chunks, one per thread. Every
+ *       thread builds a histogram of its chunk and later scatters its chunk
+ *       to the positions of its buckets behind the ones of the preceding
+ *       chunks. Therefore the order is the same as for a serial counting
+ *       sort, independent of the number of threads. The number of chunks is
+ *       limited, so that the histograms do not take more space than the
+ *       order itself.
+ */
+class bucket_sort {
+    private:
+        std::vector<uint64_t> m_sizes; // number of items per bucket plus a sentinel
+        std::vector<uint64_t> m_order; // item of each position in bucket order
+
+    public:
+        /*!
+         *  \param n        Number of items.
+         *  \param universe Number of buckets.
+         *  \param bucket   bucket(i) returns the bucket of item i; it is called
+         *                  twice per item.
+         *  \param pool     Thread pool or nullptr for a serial sort.
+         */
+        template<typename t_bucket>
+        bucket_sort(size_t n, uint64_t universe, t_bucket&& bucket, thread_pool* pool=nullptr) :
+            m_sizes(universe+1, 0), m_order(n) {
+            size_t chunks = 1;
+            if ( pool != nullptr ) {
+                chunks = std::max((size_t)1, std::min<size_t>(pool->size(), n/std::max<uint64_t>(universe, 1<<16)));
+            }
+            if ( chunks == 1 ) {
+                for (size_t i=0; i < n; ++i) {
+                    ++m_sizes[bucket(i)];
+                }
+                std::vector<uint64_t> offsets = start_positions();
+                for (size_t i=0; i < n; ++i) {
+                    m_order[offsets[bucket(i)]++] = i;
+                }
+                return;
+            }
+            const size_t grain = (n+chunks-1)/chunks;
+            std::vector<std::vector<uint64_t>> offsets(chunks);
+            pool->parallel_for(n, grain, [&](size_t begin, size_t end, size_t) {
+                auto& hist = offsets[begin/grain];
+                hist.assign(universe, 0);
+                for (size_t i=begin; i < end; ++i) {
+                    ++hist[bucket(i)];
+                }
+            });
+            // Turn the histograms into the first position of each chunk in each bucket
+            uint64_t sum = 0;
+            for (uint64_t b=0; b < universe; ++b) {
+                for (auto& hist : offsets) {
+                    if ( hist.empty() ) continue;
+                    const uint64_t cnt = hist[b];
+                    hist[b] = sum;
+                    sum += cnt;
+                    m_sizes[b] += cnt;
+                }
+            }
+            pool->parallel_for(n, grain, [&](size_t begin, size_t end, size_t) {
+                auto& pos = offsets[begin/grain];
+                for (size_t i=begin; i < end; ++i) {
+                    m_order[pos[bucket(i)]++] = i;
+                }
+            });
+        }
+
+        //! sizes()[b] is the number of items in bucket b; sizes()[universe] = 0 is a sentinel
+        const std::vector<uint64_t>& sizes() const { return m_sizes; }
+
+        //! order()[j] is the item at position j in bucket order
+        const std::vector<uint64_t>& order() const { return m_order; }
+
+        //! First position of each bucket in bucket order, plus n
+        std::vector<uint64_t> start_positions() const {
+            std::vector<uint64_t> starts(m_sizes.size(), 0);
+            uint64_t sum = 0;
+            for (size_t b=0; b < m_sizes.size(); ++b) {
+                starts[b] = sum;
+                sum += m_sizes[b];
+            }
+            return starts;
+        }
+};
+
+/*! Moves the keys of a source to their positions in bucket order by calling
+ *  store(j, key, payload) for the key at position j, and returns the bucket
+ *  sizes plus a sentinel like bucket_sort::sizes().
+ *
+ *  \par store is called concurrently for disjoint ranges of parallel_ranges.
+ *       Keys in memory are sorted with bucket_sort. Keys in a file are read
+ *       in blocks: the first pass counts the bucket sizes, every further
+ *       pass collects the keys of the next slice of positions, which are
+ *       then stored in parallel. The t-th key of a bucket in input order
+ *       gets the t-th position of the bucket, so both result in the same
+ *       order. The histograms, a block and a slice fit into the budget of
+ *       the source; the file is read once per slice plus once.
+ */
+template<typename t_bucket, typename t_store>
+std::vector<uint64_t> bucket_scatter(const key_source& keys, uint64_t universe, t_bucket&& bucket, t_store&& store, thread_pool* pool=nullptr) {
+    if ( keys.in_memory() ) {
+        const std::vector<uint64_t>& input = keys.keys();
+        const bool has_payloads = keys.has_payloads();
+        bucket_sort sorted(input.size(), universe, [&](size_t i) { return bucket(input[i]); }, pool);
+        const std::vector<uint64_t>& order = sorted.order();
+        parallel_ranges(pool, order.size(), [&](size_t begin, size_t end) {
+            for (size_t j=begin; j < end; ++j) {
+                store(j, input[order[j]], has_payloads ? keys.payloads()[order[j]] : 0);
+            }
+        });
+        return sorted.sizes();
+    }
+    const uint64_t n = keys.size();
+    const uint64_t pay_words = keys.has_payloads() ? 1 : 0;
+    const uint64_t hist_bytes = 2*(universe+1)*sizeof(uint64_t);
+    const uint64_t rest = keys.budget() > hist_bytes ? keys.budget()-hist_bytes : 0;
+    // a quarter of the rest for the keys, payloads and buckets of a block, the others for a slice
+    const uint64_t block = std::max((uint64_t)1<<10, rest/4 / ((2+pay_words)*sizeof(uint64_t)));
+    const uint64_t slice = std::max((uint64_t)1<<12, rest/4*3 / ((1+pay_words)*sizeof(uint64_t)));
+
+    std::vector<uint64_t> block_buckets(std::min(block, n));
+    auto bucket_block = [&](const uint64_t* x, size_t m) {
+        parallel_ranges(pool, m, [&](size_t begin, size_t end) {
+            for (size_t i=begin; i < end; ++i) block_buckets[i] = bucket(x[i]);
+        });
+    };
+    std::vector<uint64_t> sizes(universe+1, 0);
+    keys.for_each_block(block, [&](const uint64_t* x, const uint64_t*, size_t m) {
+        bucket_block(x, m);
+        for (size_t i=0; i < m; ++i) ++sizes[block_buckets[i]];
+    });
+
+    std::vector<uint64_t> next(universe+1, 0); // next position of each bucket
+    std::vector<uint64_t> slice_keys(std::min(slice, n)), slice_payloads(pay_words*slice_keys.size());
+    for (uint64_t first=0; first < n; first += slice) {
+        const uint64_t last = std::min(n, first+slice);
+        next[0] = 0;
+        for (uint64_t b=1; b <= universe; ++b) {
+            next[b] = next[b-1] + sizes[b-1];
+        }
+        keys.for_each_block(block, [&](const uint64_t* x, const uint64_t* payloads, size_t m) {
+            bucket_block(x, m);
+            for (size_t i=0; i < m; ++i) {
+                const uint64_t j = next[block_buckets[i]]++;
+                if ( j >= first and j < last ) {
+                    slice_keys[j-first] = x[i];
+                    if ( payloads != nullptr ) slice_payloads[j-first] = payloads[i];
+                }
+            }
+        });
+        // the ranges start at multiples of 64 of the whole arrays, not of the slice
+        const uint64_t aligned = first/64*64;
+        parallel_ranges(pool, last-aligned, [&](size_t begin, size_t end) {
+            for (uint64_t j=std::max(first, aligned+begin); j < aligned+end; ++j) {
+                store(j, slice_keys[j-first], pay_words ? slice_payloads[j-first] : 0);
+            }
+        });
+    }
+    return sizes;
+}
+
+}
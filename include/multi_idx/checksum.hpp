@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace multi_index {
+
+/*! Streaming 64-bit checksum of a byte sequence.
+ *
+ *  \par Bytes are mixed in as 64-bit words, so the checksum runs at several
+ *       GB/s. The result only depends on the bytes and not on how they are
+ *       split into update calls. It detects corruption, it is no
+ *       cryptographic hash.
+ */
+class checksum {
+    private:
+        uint64_t m_h = 0x6d756c74695f6964ULL;
+        uint64_t m_carry = 0;     // bytes of an incomplete word
+        uint8_t  m_carry_len = 0;
+        uint64_t m_len = 0;
+
+        static uint64_t rotl(uint64_t x, uint8_t r) { return (x << r) | (x >> (64-r)); }
+
+        static uint64_t fmix(uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+        void mix(uint64_t w) {
+            m_h ^= rotl(w * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+            m_h = rotl(m_h, 27) * 5 + 0x52dce729;
+        }
+
+    public:
+        void update(const void* data, uint64_t n) {
+            const char* p = (const char*)data;
+            m_len += n;
+            while ( m_carry_len > 0 and m_carry_len < 8 and n > 0 ) {
+                m_carry |= ((uint64_t)(uint8_t)*p++) << (8*m_carry_len++);
+                --n;
+            }
+            if ( m_carry_len == 8 ) {
+                mix(m_carry);
+                m_carry = 0;
+                m_carry_len = 0;
+            }
+            for (; n >= 8; n -= 8, p += 8) {
+                uint64_t w;
+                std::memcpy(&w, p, 8);
+                mix(w);
+            }
+            for (; n > 0; --n) {
+                m_carry |= ((uint64_t)(uint8_t)*p++) << (8*m_carry_len++);
+            }
+        }
+
+        template<typename T>
+        void update_member(const T& x) { update(&x, sizeof(x)); }
+
+        uint64_t value() const {
+            uint64_t h = m_h ^ fmix(m_carry ^ m_carry_len);
+            return fmix(h ^ m_len);
+        }
+};
+
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "sdsl/int_vector.hpp"
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+
+/*! Dynamic wrapper around a static index like multi_idx or multi_idx_red.
+ *  \tparam t_index Static index class; it is rebuilt from scratch on merges.
+ *
+ *  \par Keys are kept in three parts:
+ *       - the static base index and the sorted vector of its keys,
+ *       - a small delta buffer of inserted keys, which is searched by a
+ *         linear scan with the SIMD kernels of scan_kernels.hpp,
+ *       - tombstones for keys of the base index which were deleted.
+ *       Once the delta buffer (plus tombstones) reaches merge_threshold
+ *       entries, a background thread builds a fresh static index. Readers are
+ *       only blocked while the new index is swapped in; updates which arrive
+ *       during the construction are logged and replayed on the new state.
+ *
+ *  \par Like the keys, the results of match are a set: each contained key
+ *       within the radius is reported once.
+ *
+ *  \par All methods are thread-safe.
+ */
+template<typename t_index>
+class dynamic_multi_idx {
+    public:
+        typedef uint64_t size_type;
+        static constexpr uint8_t k = t_index::k;
+
+    private:
+        enum op_type : uint8_t { op_insert, op_erase };
+
+        mutable std::shared_timed_mutex          m_mtx;
+        std::shared_ptr<const t_index>           m_base;
+        std::shared_ptr<const std::vector<uint64_t>> m_base_keys; // sorted keys of m_base
+        std::vector<uint64_t>                    m_delta_keys;
+        std::vector<uint32_t>                    m_delta_low;  // low 32 bits of m_delta_keys for the SIMD scan
+        std::unordered_map<uint64_t, size_t>     m_delta_pos;  // position of a key in m_delta_keys
+        std::unordered_set<uint64_t>             m_tombstones;
+        size_t                                   m_merge_threshold;
+        bool                                     m_merging = false;
+        std::vector<std::pair<op_type, uint64_t>> m_log;       // updates during a merge
+        std::mutex                               m_future_mtx;
+        std::future<void>                        m_merge_future;
+        std::exception_ptr                       m_merge_error;  // failure of a finished background merge
+
+    public:
+        /*!
+        *  \param keys            Initial keys; duplicates are removed.
+        *  \param merge_threshold Number of delta entries and tombstones which
+        *                         trigger a background merge (0 = never).
+        */
+        dynamic_multi_idx(std::vector<uint64_t> keys={}, size_t merge_threshold=1<<16) : m_merge_threshold(merge_threshold) {
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            if ( !keys.empty() ) {
+                m_base = std::make_shared<const t_index>(keys);
+            }
+            m_base_keys = std::make_shared<const std::vector<uint64_t>>(std::move(keys));
+        }
+
+        dynamic_multi_idx(const dynamic_multi_idx&) = delete;
+        dynamic_multi_idx& operator=(const dynamic_multi_idx&) = delete;
+
+        ~dynamic_multi_idx() {
+            try {
+                wait_for_merge();
+            } catch (...) {
+            }
+        }
+
+        //! Inserts key x; returns false if x is already contained
+        bool insert(uint64_t x) {
+            bool inserted;
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_mtx);
+                inserted = apply(op_insert, x);
+                if ( inserted and m_merging ) {
+                    m_log.emplace_back(op_insert, x);
+                }
+            }
+            if ( inserted ) {
+                maybe_merge();
+            }
+            return inserted;
+        }
+
+        //! Deletes key x; returns false if x is not contained
+        bool erase(uint64_t x) {
+            bool erased;
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(m_mtx);
+                erased = apply(op_erase, x);
+                if ( erased and m_merging ) {
+                    m_log.emplace_back(op_erase, x);
+                }
+            }
+            if ( erased ) {
+                maybe_merge();
+            }
+            return erased;
+        }
+
+        //! Returns all keys within distance k of query (each once) and the number of checked candidates
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) const {
+            return match(query, k, find_only_candidates);
+        }
+
+        //! Returns all keys within distance radius <= k of query (each once) and the number of checked candidates
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, int radius, const bool find_only_candidates=false) const {
+            std::vector<uint64_t> matches;
+            if ( !find_only_candidates ) {
+                const uint64_t candidates = match(query, matches, radius);
+                return {matches, candidates};
+            }
+            std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+            uint64_t candidates = m_delta_keys.size();
+            if ( m_base ) {
+                candidates += std::get<1>(m_base->match(query, radius, true));
+            }
+            return {matches, candidates};
+        }
+
+        /*! Appends the keys within distance radius <= k of query to out and returns the number of checked candidates
+         *  \par Each contained key is reported exactly once: first the matches
+         *       of the base index (via t_index::visit_unique, so a key found by
+         *       several permutations is not repeated), then those of the delta
+         *       buffer. The two parts are disjoint and no order is guaranteed.
+         */
+        uint64_t match(const uint64_t query, std::vector<uint64_t>& out, int radius=k) const {
+            radius = std::max(0, std::min((int)k, radius));
+            std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+            uint64_t candidates = 0;
+            if ( m_base ) {
+                candidates += m_base->visit_unique(query, [&](uint64_t x) {
+                    if ( m_tombstones.empty() or m_tombstones.count(x) == 0 ) {
+                        out.push_back(x);
+                    }
+                }, radius);
+            }
+            candidates += m_delta_keys.size();
+            filter_low_entries(m_delta_low.data(), m_delta_low.size(), (uint32_t)query, radius, [&](size_t i) {
+                if ( (int)sdsl::bits::cnt(m_delta_keys[i]^query) <= radius ) {
+                    out.push_back(m_delta_keys[i]);
+                }
+                return true;
+            });
+            return candidates;
+        }
+
+        //! Number of contained keys
+        uint64_t size() const {
+            std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+            return m_base_keys->size() - m_tombstones.size() + m_delta_keys.size();
+        }
+
+        uint64_t delta_size() const {
+            std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+            return m_delta_keys.size();
+        }
+
+        uint64_t tombstones() const {
+            std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+            return m_tombstones.size();
+        }
+
+        /*! Merges delta buffer and tombstones into a new static index and waits for it
+         *  \par If the construction throws, the index keeps its current
+         *       state (no key is lost) and the exception is passed on.
+         */
+        void merge() {
+            wait_for_merge();
+            if ( start_merge() ) {
+                run_merge();
+            }
+        }
+
+        //! Starts a merge in a background thread unless one is already running
+        void merge_async() {
+            std::lock_guard<std::mutex> lock(m_future_mtx);
+            if ( start_merge() ) {
+                collect_merge();
+                m_merge_future = std::async(std::launch::async, [this](){ run_merge(); });
+            }
+        }
+
+        /*! Blocks until a running background merge is finished
+         *  \par Rethrows the exception of a background merge which failed
+         *       since the last call; the index keeps its state in this case.
+         */
+        void wait_for_merge() {
+            std::lock_guard<std::mutex> lock(m_future_mtx);
+            collect_merge();
+            if ( m_merge_error ) {
+                std::exception_ptr error = m_merge_error;
+                m_merge_error = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        // Applies an update to the current state; requires the exclusive lock
+        bool apply(op_type op, uint64_t x) {
+            const bool in_base = std::binary_search(m_base_keys->begin(), m_base_keys->end(), x);
+            if ( op == op_insert ) {
+                if ( in_base ) {
+                    return m_tombstones.erase(x) > 0;
+                }
+                if ( m_delta_pos.count(x) ) {
+                    return false;
+                }
+                m_delta_pos[x] = m_delta_keys.size();
+                m_delta_keys.push_back(x);
+                m_delta_low.push_back((uint32_t)x);
+                return true;
+            } else {
+                auto it = m_delta_pos.find(x);
+                if ( it != m_delta_pos.end() ) {
+                    // move the last entry into the gap
+                    const size_t pos = it->second;
+                    m_delta_pos.erase(it);
+                    if ( pos+1 != m_delta_keys.size() ) {
+                        m_delta_keys[pos] = m_delta_keys.back();
+                        m_delta_low[pos] = m_delta_low.back();
+                        m_delta_pos[m_delta_keys[pos]] = pos;
+                    }
+                    m_delta_keys.pop_back();
+                    m_delta_low.pop_back();
+                    return true;
+                }
+                return in_base and m_tombstones.insert(x).second;
+            }
+        }
+
+        void maybe_merge() {
+            bool full;
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+                full = m_merge_threshold > 0 and !m_merging and
+                       m_delta_keys.size() + m_tombstones.size() >= m_merge_threshold;
+            }
+            if ( full ) {
+                merge_async();
+            }
+        }
+
+        // Waits for the background merge and keeps its exception; requires m_future_mtx
+        void collect_merge() {
+            if ( !m_merge_future.valid() ) return;
+            try {
+                m_merge_future.get();
+            } catch (...) {
+                m_merge_error = std::current_exception();
+            }
+        }
+
+        // Ends a merge which did not finish: updates were applied to the current state already, so the log is dropped
+        struct merge_guard {
+            dynamic_multi_idx& idx;
+            bool done = false;
+
+            ~merge_guard() {
+                if ( done ) return;
+                std::unique_lock<std::shared_timed_mutex> lock(idx.m_mtx);
+                idx.m_log.clear();
+                idx.m_merging = false;
+            }
+        };
+
+        bool start_merge() {
+            std::unique_lock<std::shared_timed_mutex> lock(m_mtx);
+            if ( m_merging ) return false;
+            m_merging = true;
+            m_log.clear();
+            return true;
+        }
+
+        void run_merge() {
+            merge_guard guard{*this};
+            std::vector<uint64_t> keys;
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(m_mtx);
+                keys.reserve(m_base_keys->size() - m_tombstones.size() + m_delta_keys.size());
+                for (auto x : *m_base_keys) {
+                    if ( m_tombstones.count(x) == 0 ) {
+                        keys.push_back(x);
+                    }
+                }
+                keys.insert(keys.end(), m_delta_keys.begin(), m_delta_keys.end());
+            }
+            // Updates between taking the snapshot and here are in m_log
+            std::sort(keys.begin(), keys.end());
+            std::shared_ptr<const t_index> base;
+            if ( !keys.empty() ) {
+                base = std::make_shared<const t_index>(keys);
+            }
+            auto base_keys = std::make_shared<const std::vector<uint64_t>>(std::move(keys));
+
+            std::unique_lock<std::shared_timed_mutex> lock(m_mtx);
+            m_base = std::move(base);
+            m_base_keys = std::move(base_keys);
+            m_delta_keys.clear();
+            m_delta_low.clear();
+            m_delta_pos.clear();
+            m_tombstones.clear();
+            for (auto& entry : m_log) {
+                apply(entry.first, entry.second);
+            }
+            m_log.clear();
+            m_merging = false;
+            guard.done = true;
+        }
+};
+
+}
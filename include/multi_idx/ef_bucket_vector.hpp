@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <utility>
+#include "sdsl/io.hpp"
+#include "sdsl/int_vector.hpp"
+#include "multi_idx/mmap_io.hpp"
+
+namespace multi_index {
+
+/*! Elias-Fano coded replacement of the bucket bit vector m_C.
+ *
+ *  m_C consists of a 0 per entry (or cluster) and a 1 behind each bucket,
+ *  so it has 2^splitter_bits+n bits and its select structure adds more.
+ *  For many splitter bits most of it encodes empty buckets. This class
+ *  instead stores for each 0 the number of 1s before it, i.e. its bucket,
+ *  as a monotone Elias-Fano sequence: the low bits packed, the high bits
+ *  unary in m_high. It takes about z*(2+log((o+1)/z)) bits for z zeros
+ *  and o ones instead of z+o, which is much smaller when buckets are
+ *  sparse and never larger when they are dense.
+ *
+ *  m_high is stored in cache-line blocks: a word with the number of zeros
+ *  of m_high before the block, followed by block_bits bits of m_high. A
+ *  small array holds the block of every hint_rate-th zero. select_1(b) =
+ *  b-1 + (entries in buckets < b) therefore reads the hint, then counts
+ *  zeros from the header of one block, and the ones behind the selected
+ *  zero are usually in the same block. The only other access is a binary
+ *  search over the low bits of the entries with the same high part, so a
+ *  lookup costs about two cache misses.
+ *
+ *  \par The class provides the part of the sdsl::bit_vector interface
+ *       which the bucket strategies use, so it is a drop-in for their t_bv
+ *       parameter, e.g. simple_buckets_binvector_split<ef_bucket_vector>.
+ *       Bits are written once in increasing order of position; the
+ *       vector is finalized when its select structure is built.
+ */
+class ef_bucket_vector {
+    public:
+        typedef uint64_t size_type;
+        static constexpr uint64_t block_words = 8;                   // one cache line
+        static constexpr uint64_t block_bits  = 64*(block_words-1);  // bits of m_high per block
+        static constexpr uint64_t hint_rate   = 256;                 // zeros of m_high per hint
+
+        class reference;
+        class select_1_type;
+        class rank_1_type;
+
+    private:
+        uint64_t                m_size  = 0;  // bits of the represented vector
+        uint64_t                m_ones  = 0;
+        uint64_t                m_zeros = 0;
+        uint64_t                m_low_width = 0;
+        // m_high holds the unary high parts: element i is the 1 at (value_i >> low_width) + i
+        mappable_int_vector<64> m_blocks;     // m_high in blocks: zeros before the block, then block_bits bits
+        mappable_int_vector<32> m_hints;      // block of every hint_rate-th 0 of m_high
+        mappable_int_vector<>   m_low;        // low parts of the elements
+
+        // Construction state; the elements are buffered until finalize
+        uint64_t                m_next  = 0;  // first position which was not written yet
+        std::vector<uint64_t>   m_pending;
+        bool                    m_final = true;
+
+    public:
+        ef_bucket_vector() = default;
+
+        //! Vector of n zeros; set its ones with operator[] in increasing order
+        explicit ef_bucket_vector(size_type n, bool value=false) : m_size(n), m_final(false) {
+            if ( value ) throw std::invalid_argument("ef_bucket_vector: only zero initialization is supported");
+        }
+
+        class reference {
+            private:
+                ef_bucket_vector* m_v;
+                uint64_t          m_i;
+            public:
+                reference(ef_bucket_vector* v, uint64_t i) : m_v(v), m_i(i) {}
+                reference& operator=(uint64_t x) {
+                    if ( x ) m_v->set_one(m_i);
+                    return *this;
+                }
+        };
+
+        reference operator[](size_type i) { return reference(this, i); }
+
+        size_type size() const { return m_size; }
+
+        //! True if the encoded vector lives in a memory mapping
+        bool is_mapped() const { return m_blocks.is_mapped(); }
+
+        //! Position of the i-th one, 1 <= i <= number of ones
+        uint64_t select_1(uint64_t i) const {
+            return i - 1 + count_less(i);
+        }
+
+        //! Number of ones in [0, p)
+        uint64_t rank_1(uint64_t p) const {
+            uint64_t lo = 0, hi = m_ones; // select_1(lo) < p unless lo = 0
+            while ( lo < hi ) {
+                const uint64_t mid = lo + (hi-lo+1)/2;
+                if ( select_1(mid) < p ) lo = mid; else hi = mid-1;
+            }
+            return lo;
+        }
+
+        //! Number of zeros before the v-th one, i.e. of elements with value < v
+        uint64_t count_less(uint64_t v) const {
+            // the elements with high part h are the run of ones behind the (h-1)-th zero
+            const uint64_t h = v >> m_low_width;
+            const uint64_t run = h == 0 ? 0 : select_0_high(h-1)+1;
+            const uint64_t first = run - h;
+            if ( m_low_width == 0 ) return first;
+            return lower_bound_low(first, first + ones_run(run), v & ((1ULL << m_low_width)-1));
+        }
+
+        /*! Elements with a value in [first, last], i.e. the entries [l, r) of
+         *  the buckets first..last. Both ends are found in the run of the high
+         *  part of first with one select_0 unless last has a larger high part.
+         */
+        std::pair<uint64_t, uint64_t> bucket_range(uint64_t first, uint64_t last) const {
+            const uint64_t h = first >> m_low_width;
+            const uint64_t run = h == 0 ? 0 : select_0_high(h-1)+1;
+            const uint64_t run_begin = run - h;
+            const uint64_t run_end = run_begin + ones_run(run);
+            const uint64_t mask = (1ULL << m_low_width)-1;
+            uint64_t l = run_begin;
+            if ( m_low_width > 0 ) l = lower_bound_low(run_begin, run_end, first & mask);
+            const uint64_t h_end = (last+1) >> m_low_width;
+            if ( h_end == h ) return {l, lower_bound_low(l, run_end, (last+1) & mask)};
+            if ( h_end == h+1 and ((last+1) & mask) == 0 ) return {l, run_end}; // last is the largest value of the run
+            return {l, count_less(last+1)};
+        }
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream& out, sdsl::structure_tree_node* v=nullptr, std::string name="") const {
+            using namespace sdsl;
+            finalize();
+            structure_tree_node* child = structure_tree::add_child(v, name, util::class_name(*this));
+            uint64_t written_bytes = 0;
+            written_bytes += write_member(m_size, out, child, "size");
+            written_bytes += write_member(m_ones, out, child, "ones");
+            written_bytes += write_member(m_zeros, out, child, "zeros");
+            written_bytes += write_member(m_low_width, out, child, "low_width");
+            written_bytes += m_blocks.serialize(out, child, "blocks");
+            written_bytes += m_hints.serialize(out, child, "hints");
+            written_bytes += m_low.serialize(out, child, "low");
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        //! Loads the data structure from the given istream.
+        void load(std::istream& in) {
+            sdsl::read_member(m_size, in);
+            sdsl::read_member(m_ones, in);
+            sdsl::read_member(m_zeros, in);
+            sdsl::read_member(m_low_width, in);
+            m_blocks.load(in);
+            m_hints.load(in);
+            m_low.load(in);
+            m_next = m_size;
+            m_pending = std::vector<uint64_t>();
+            m_final = true;
+        }
+
+        //! Builds the Elias-Fano representation of the written bits; afterwards the vector is read-only
+        void finalize() const {
+            if ( !m_final ) const_cast<ef_bucket_vector*>(this)->build();
+        }
+
+    private:
+        void set_one(uint64_t i) {
+            if ( i >= m_size ) return; // like the slack of an sdsl::bit_vector
+            if ( m_final or i < m_next ) throw std::logic_error("ef_bucket_vector: bits have to be set once in increasing order");
+            m_pending.insert(m_pending.end(), i - m_next, m_ones);
+            ++m_ones;
+            m_next = i+1;
+        }
+
+        void build() {
+            m_pending.insert(m_pending.end(), m_size - m_next, m_ones);
+            m_next = m_size;
+            m_zeros = m_pending.size();
+            const uint64_t universe = m_ones+1;
+            m_low_width = (m_zeros > 0 and universe > m_zeros) ? sdsl::bits::hi(universe / m_zeros) : 0;
+
+            // a zero behind the run of each high part up to the one of m_ones
+            const uint64_t high_bits = m_zeros + (m_ones >> m_low_width) + 1;
+            sdsl::int_vector<64> high((high_bits+63)/64, 0);
+            sdsl::int_vector<> low(m_zeros, 0, m_low_width == 0 ? 1 : m_low_width);
+            for (uint64_t i = 0; i < m_zeros; ++i) {
+                const uint64_t pos = (m_pending[i] >> m_low_width) + i;
+                high[pos >> 6] = high[pos >> 6] | (1ULL << (pos & 63));
+                if ( m_low_width > 0 ) low[i] = m_pending[i] & ((1ULL << m_low_width)-1);
+            }
+            const uint64_t high_words = high.size();
+            const uint64_t blocks = (high_words + block_words-2) / (block_words-1);
+            sdsl::int_vector<64> block_vec(blocks*block_words, 0);
+            std::vector<uint64_t> hints;
+            for (uint64_t w = 0, zeros = 0; w < high_words; ++w) {
+                const uint64_t b = w / (block_words-1);
+                if ( w % (block_words-1) == 0 ) block_vec[b*block_words] = zeros;
+                block_vec[b*block_words + 1 + w % (block_words-1)] = high[w];
+                const uint64_t valid = std::min<uint64_t>(64, high_bits - 64*w);
+                const uint64_t c = sdsl::bits::cnt(~high[w] & (valid == 64 ? ~0ULL : (1ULL << valid)-1));
+                while ( hints.size()*hint_rate < zeros + c ) hints.push_back(b);
+                zeros += c;
+            }
+            sdsl::int_vector<32> hint_vec(hints.size(), 0);
+            for (size_t i = 0; i < hints.size(); ++i) hint_vec[i] = hints[i];
+            m_blocks = std::move(block_vec);
+            m_hints  = std::move(hint_vec);
+            m_low    = std::move(low);
+            m_pending = std::vector<uint64_t>();
+            m_final = true;
+        }
+
+        // Word w of m_high
+        uint64_t high_word(uint64_t w) const {
+            return m_blocks[(w / (block_words-1))*block_words + 1 + w % (block_words-1)];
+        }
+
+        // Position of the h-th zero (0-based) in m_high
+        uint64_t select_0_high(uint64_t h) const {
+            uint64_t b = m_hints[h / hint_rate];
+            uint64_t rest = h - m_blocks[b*block_words];
+            for (;; ++b) {
+                for (uint64_t i = 1; i < block_words; ++i) {
+                    const uint64_t word = ~m_blocks[b*block_words + i];
+                    const uint64_t c = sdsl::bits::cnt(word);
+                    if ( rest < c ) return b*block_bits + (i-1)*64 + sdsl::bits::sel(word, rest+1);
+                    rest -= c;
+                }
+            }
+        }
+
+        // First element in [lo, hi) with a low part >= low; the elements of a run are sorted by it
+        uint64_t lower_bound_low(uint64_t lo, uint64_t hi, const uint64_t low) const {
+            while ( lo < hi ) {
+                const uint64_t mid = lo + (hi-lo)/2;
+                if ( m_low[mid] < low ) lo = mid+1; else hi = mid;
+            }
+            return lo;
+        }
+
+        // Number of consecutive ones in m_high starting at pos
+        uint64_t ones_run(uint64_t pos) const {
+            uint64_t run = 0;
+            for (uint64_t w = pos >> 6, off = pos & 63; ; ++w, off = 0) {
+                const uint64_t zeros = ~(high_word(w) >> off); // bits above 64-off are ones
+                if ( zeros != 0 ) {
+                    const uint64_t t = __builtin_ctzll(zeros);
+                    if ( t < 64-off ) return run + t;
+                }
+                run += 64-off;
+            }
+        }
+
+    public:
+        class select_1_type {
+            private:
+                const ef_bucket_vector* m_v = nullptr;
+            public:
+                select_1_type(const ef_bucket_vector* v=nullptr) { set_vector(v); }
+                void set_vector(const ef_bucket_vector* v) {
+                    m_v = v;
+                    if ( m_v != nullptr ) m_v->finalize();
+                }
+                uint64_t operator()(uint64_t i) const { return m_v->select_1(i); }
+                // The samples are part of the vector
+                size_type serialize(std::ostream&, sdsl::structure_tree_node* =nullptr, std::string="") const { return 0; }
+                void load(std::istream&, const ef_bucket_vector* v=nullptr) { set_vector(v); }
+        };
+
+        class rank_1_type {
+            private:
+                const ef_bucket_vector* m_v = nullptr;
+            public:
+                rank_1_type(const ef_bucket_vector* v=nullptr) { set_vector(v); }
+                void set_vector(const ef_bucket_vector* v) {
+                    m_v = v;
+                    if ( m_v != nullptr ) m_v->finalize();
+                }
+                uint64_t operator()(uint64_t p) const { return m_v->rank_1(p); }
+                size_type serialize(std::ostream&, sdsl::structure_tree_node* =nullptr, std::string="") const { return 0; }
+                void load(std::istream&, const ef_bucket_vector* v=nullptr) { set_vector(v); }
+        };
+};
+
+//! Fused lookup of the entries of a bucket, see bucket_range.hpp
+inline std::pair<uint64_t, uint64_t> bucket_range(const ef_bucket_vector& C, const ef_bucket_vector::select_1_type&, const uint64_t bucket) {
+    return C.bucket_range(bucket, bucket);
+}
+
+inline std::pair<uint64_t, uint64_t> bucket_range(const ef_bucket_vector& C, const ef_bucket_vector::select_1_type&, const uint64_t first, const uint64_t last) {
+    return C.bucket_range(first, last);
+}
+
+}
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "multi_idx/index_registry.hpp"
+#include "multi_idx/checksum.hpp"
+#include "multi_idx/mmap_io.hpp"
+
+namespace multi_index {
+
+//! Construction parameters recorded in an index file
+struct index_build_params {
+    uint64_t parallel = 0;  // parallel construction
+    uint64_t budget_mb = 0; // scratch memory budget of a streamed construction; 0 = keys in memory
+};
+
+/*! Header of an index file written by store_index.
+ *
+ *  \par Layout of an index file:
+ *       [header][header checksum][index][number of sections][section checksums]
+ *       The serialized index (the body) is split into sections of
+ *       section_bytes bytes; the last one may be shorter. The checksums of the
+ *       sections follow the body, since they are only known after it is
+ *       written. All header fields have a fixed width for a given strategy id,
+ *       so the header is written twice: before the body to reserve its space,
+ *       and after it with the final body size.
+ *
+ *  \par load only validates the header itself. Checking the header against
+ *       an index type and the file size is cheap (see validate) and done on
+ *       every load_index; the section checksums have to read the whole file
+ *       and are only checked by verify_sections.
+ */
+struct index_header {
+    static constexpr uint64_t magic = 0x5844495f49544c4dULL; // "MLTI_IDX"
+    static constexpr uint64_t format_version = 2;
+    static constexpr uint64_t default_section_bytes = 1ULL<<24;
+
+    uint64_t            version = format_version;
+    std::string         strategy;
+    uint64_t            k = 0;
+    uint64_t            blocks = 0;
+    uint64_t            block_errors = 0;
+    uint64_t            perm_hash = 0;    // index_traits::perm_hash() of the index type
+    uint64_t            keys = 0;         // size() of the index
+    index_build_params  build;
+    uint64_t            body_offset = 0;  // bytes of the header and its checksum
+    uint64_t            body_bytes = 0;
+    uint64_t            section_bytes = default_section_bytes;
+    std::vector<uint64_t> section_checksums;
+
+    index_header() = default;
+
+    template<typename t_index>
+    explicit index_header(const registry_entry<t_index>& entry) :
+        strategy(entry.strategy), k(entry.k), blocks(entry.blocks), block_errors(entry.block_errors),
+        perm_hash(index_traits<t_index>::perm_hash()) {}
+
+    uint64_t sections() const {
+        return (body_bytes + section_bytes - 1) / section_bytes;
+    }
+
+    //! Size of a complete index file with this header
+    uint64_t file_bytes() const {
+        return body_offset + body_bytes + (1 + sections())*sizeof(uint64_t);
+    }
+
+    //! Writes the header and its checksum
+    void serialize(std::ostream& out) const {
+        const std::string fields = serialize_fields();
+        checksum c;
+        c.update(fields.data(), fields.size());
+        const uint64_t header_checksum = c.value();
+        out.write(fields.data(), fields.size());
+        sdsl::write_member(header_checksum, out);
+    }
+
+    //! Writes the section checksums which follow the body
+    void serialize_trailer(std::ostream& out) const {
+        const uint64_t n = section_checksums.size();
+        sdsl::write_member(n, out);
+        out.write((const char*)section_checksums.data(), n*sizeof(uint64_t));
+    }
+
+    /*! Reads a header from the start of an index file.
+     *  \return False with a reason in error if in does not start with a
+     *          valid header of a supported version.
+     */
+    bool load(std::istream& in, std::string& error) {
+        uint64_t m = 0, len = 0, header_checksum = 0;
+        sdsl::read_member(m, in);
+        if ( !in or m != magic ) {
+            error = "not an index file";
+            return false;
+        }
+        sdsl::read_member(version, in);
+        if ( !in or version != format_version ) {
+            error = "unsupported format version " + std::to_string(version) + ", expected " + std::to_string(format_version);
+            return false;
+        }
+        sdsl::read_member(len, in);
+        if ( !in or len > 256 ) {
+            error = "corrupt header";
+            return false;
+        }
+        strategy.assign(len, ' ');
+        in.read(&strategy[0], len);
+        sdsl::read_member(k, in);
+        sdsl::read_member(blocks, in);
+        sdsl::read_member(block_errors, in);
+        sdsl::read_member(perm_hash, in);
+        sdsl::read_member(keys, in);
+        sdsl::read_member(build.parallel, in);
+        sdsl::read_member(build.budget_mb, in);
+        sdsl::read_member(body_offset, in);
+        sdsl::read_member(body_bytes, in);
+        sdsl::read_member(section_bytes, in);
+        sdsl::read_member(header_checksum, in);
+        const std::string fields = serialize_fields();
+        checksum c;
+        c.update(fields.data(), fields.size());
+        if ( !in or c.value() != header_checksum or section_bytes == 0 ) {
+            error = "corrupt header";
+            return false;
+        }
+        return true;
+    }
+
+    //! Reads the section checksums; in has to be positioned behind the body
+    bool load_trailer(std::istream& in) {
+        uint64_t n = 0;
+        sdsl::read_member(n, in);
+        if ( !in or n != sections() ) return false;
+        section_checksums.resize(n);
+        in.read((char*)section_checksums.data(), n*sizeof(uint64_t));
+        return (bool)in;
+    }
+
+    //! True if the header was written for the index type of entry
+    template<typename t_index>
+    bool matches(const registry_entry<t_index>& entry) const {
+        return strategy == entry.strategy and k == entry.k and
+               blocks == entry.blocks and block_errors == entry.block_errors;
+    }
+
+    /*! Cheap checks of a loaded header against the index type of entry and
+     *  the size of its file.
+     *  \return False with a reason in error if the file can not be loaded.
+     */
+    template<typename t_index>
+    bool validate(const registry_entry<t_index>& entry, uint64_t file_size, std::string& error) const {
+        if ( !matches(entry) ) {
+            error = "contains a " + strategy + " index with k=" + std::to_string(k) + ", expected "
+                  + entry.strategy + " with k=" + std::to_string(entry.k);
+            return false;
+        }
+        if ( perm_hash != index_traits<t_index>::perm_hash() ) {
+            error = "was built with different permutations";
+            return false;
+        }
+        if ( file_size != file_bytes() ) {
+            error = "has " + std::to_string(file_size) + " bytes, expected " + std::to_string(file_bytes());
+            return false;
+        }
+        return true;
+    }
+
+    /*! Recomputes the section checksums of the mapped index file.
+     *  \return The ids of the sections whose checksum differs.
+     */
+    std::vector<uint64_t> verify_sections(const mmap_file& map) const {
+        std::vector<uint64_t> bad;
+        for (uint64_t s=0; s < sections(); ++s) {
+            const uint64_t begin = body_offset + s*section_bytes;
+            const uint64_t bytes = std::min(section_bytes, body_bytes - s*section_bytes);
+            checksum c;
+            c.update(map.data() + begin, bytes);
+            if ( s >= section_checksums.size() or c.value() != section_checksums[s] ) {
+                bad.push_back(s);
+            }
+        }
+        return bad;
+    }
+
+    private:
+        std::string serialize_fields() const {
+            std::ostringstream out;
+            const uint64_t m = magic, len = strategy.size();
+            sdsl::write_member(m, out);
+            sdsl::write_member(version, out);
+            sdsl::write_member(len, out);
+            out.write(strategy.data(), len);
+            sdsl::write_member(k, out);
+            sdsl::write_member(blocks, out);
+            sdsl::write_member(block_errors, out);
+            sdsl::write_member(perm_hash, out);
+            sdsl::write_member(keys, out);
+            sdsl::write_member(build.parallel, out);
+            sdsl::write_member(build.budget_mb, out);
+            sdsl::write_member(body_offset, out);
+            sdsl::write_member(body_bytes, out);
+            sdsl::write_member(section_bytes, out);
+            return out.str();
+        }
+};
+
+/*! streambuf which forwards everything written to another one and computes
+ *  the checksums of consecutive sections of section_bytes bytes.
+ *  Small writes (e.g. the members written by write_member) are collected in
+ *  a put area of buffer_bytes, which is forwarded and checksummed as a whole
+ *  block, so the checksum does not run per member.
+ *  tellp() of a stream on it returns the position in the underlying file,
+ *  so that page alignment in mappable_int_vector::serialize is preserved.
+ */
+class section_checksum_buf : public std::streambuf {
+    public:
+        static constexpr uint64_t buffer_bytes = 1ULL << 16;
+
+    private:
+        std::streambuf*       m_out;
+        uint64_t              m_offset;        // file position of the first byte
+        uint64_t              m_section_bytes;
+        uint64_t              m_bytes = 0;     // bytes forwarded so far
+        checksum              m_section;
+        std::vector<uint64_t> m_checksums;
+        std::vector<char>     m_buffer;
+
+        // Forwards [s, s+n) and checksums it; returns the number of bytes forwarded
+        std::streamsize forward(const char* s, std::streamsize n) {
+            const std::streamsize written = m_out->sputn(s, n);
+            for (std::streamsize done = 0; done < written; ) {
+                const uint64_t in_section = m_bytes % m_section_bytes;
+                const uint64_t len = std::min<uint64_t>(written - done, m_section_bytes - in_section);
+                m_section.update(s + done, len);
+                done += len;
+                m_bytes += len;
+                if ( m_bytes % m_section_bytes == 0 ) {
+                    m_checksums.push_back(m_section.value());
+                    m_section = checksum();
+                }
+            }
+            return written;
+        }
+
+        // Forwards the put area; false if the underlying streambuf failed
+        bool flush_buffer() {
+            const std::streamsize n = pptr() - pbase();
+            const bool ok = n == 0 or forward(pbase(), n) == n;
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+            return ok;
+        }
+
+    public:
+        section_checksum_buf(std::streambuf* out, uint64_t offset, uint64_t section_bytes) :
+            m_out(out), m_offset(offset), m_section_bytes(section_bytes), m_buffer(buffer_bytes) {
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        }
+
+        //! Bytes written so far, including the ones in the put area
+        uint64_t bytes() const { return m_bytes + (pptr() - pbase()); }
+
+        //! Forwards the put area and returns the checksums of all sections, including a last incomplete one
+        std::vector<uint64_t> finish() {
+            flush_buffer();
+            if ( m_bytes % m_section_bytes != 0 ) {
+                m_checksums.push_back(m_section.value());
+                m_section = checksum();
+            }
+            return m_checksums;
+        }
+
+    protected:
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            if ( n <= epptr() - pptr() ) {
+                std::memcpy(pptr(), s, n);
+                pbump((int)n);
+                return n;
+            }
+            if ( !flush_buffer() ) return 0;
+            if ( n < (std::streamsize)m_buffer.size() ) {
+                std::memcpy(pptr(), s, n);
+                pbump((int)n);
+                return n;
+            }
+            // large arrays bypass the put area
+            return forward(s, n);
+        }
+
+        int_type overflow(int_type c) override {
+            if ( !flush_buffer() ) return traits_type::eof();
+            if ( traits_type::eq_int_type(c, traits_type::eof()) ) return traits_type::not_eof(c);
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+            return c;
+        }
+
+        int sync() override {
+            return flush_buffer() ? 0 : -1;
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+            if ( off != 0 or dir != std::ios_base::cur ) return pos_type(off_type(-1));
+            return pos_type(m_offset + bytes());
+        }
+};
+
+/*! Writes idx with a header for entry to file.
+ *  \param build         Construction parameters recorded in the header.
+ *  \param section_bytes Size of the checksummed sections of the index.
+ */
+template<typename t_index>
+bool store_index(const t_index& idx, const registry_entry<t_index>& entry, const std::string& file,
+                 const index_build_params& build = index_build_params(),
+                 uint64_t section_bytes = index_header::default_section_bytes) {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if ( !out ) return false;
+    index_header header(entry);
+    header.keys = idx.size();
+    header.build = build;
+    header.section_bytes = section_bytes;
+    header.serialize(out); // reserves the space of the header
+    header.body_offset = out.tellp();
+    section_checksum_buf buf(out.rdbuf(), header.body_offset, section_bytes);
+    {
+        std::ostream body(&buf);
+        idx.serialize(body);
+        body.flush();
+        if ( !body ) return false;
+    }
+    header.body_bytes = buf.bytes();
+    header.section_checksums = buf.finish();
+    header.serialize_trailer(out);
+    out.seekp(0);
+    header.serialize(out);
+    return (bool)out;
+}
+
+/*! Reads the header of an index file including its section checksums.
+ *  \return False with a reason in error if the file has no valid header.
+ */
+inline bool load_index_header(index_header& header, const std::string& file, std::string& error) {
+    std::ifstream in(file, std::ios::binary);
+    if ( !in ) {
+        error = "can not be opened";
+        return false;
+    }
+    if ( !header.load(in, error) ) return false;
+    in.seekg(header.body_offset + header.body_bytes);
+    if ( !header.load_trailer(in) ) {
+        error = "is truncated";
+        return false;
+    }
+    return true;
+}
+
+/*! Loads an index written by store_index, after validating its header
+ *  against the type of entry. Prints the reason if the file is rejected.
+ *  \param map If not nullptr, the file is mapped and the packed arrays of
+ *             idx point into the mapping, see load_from_file_mapped.
+ */
+template<typename t_index>
+bool load_index(t_index& idx, const registry_entry<t_index>& entry, const std::string& file, mmap_file* map=nullptr) {
+    index_header header;
+    std::string error;
+    auto load = [&](std::istream& in, uint64_t file_size) {
+        if ( !header.load(in, error) or !header.validate(entry, file_size, error) ) {
+            return false;
+        }
+        in.seekg(header.body_offset);
+        idx.load(in);
+        if ( !in ) {
+            error = "is corrupt";
+            return false;
+        }
+        if ( idx.size() != header.keys ) {
+            error = "has " + std::to_string(idx.size()) + " keys, expected " + std::to_string(header.keys);
+            return false;
+        }
+        return true;
+    };
+    bool loaded = false;
+    if ( map != nullptr ) {
+        if ( map->open(file) ) {
+            mmap_istream in(*map);
+            loaded = load(in, map->size());
+        } else {
+            error = "can not be mapped";
+        }
+    } else {
+        std::ifstream in(file, std::ios::binary | std::ios::ate);
+        if ( in ) {
+            const uint64_t file_size = in.tellg();
+            in.seekg(0);
+            loaded = load(in, file_size);
+        } else {
+            error = "can not be opened";
+        }
+    }
+    if ( !loaded ) {
+        std::cout << "ERROR: " << file << " " << error << "." << std::endl;
+    }
+    return loaded;
+}
+
+}
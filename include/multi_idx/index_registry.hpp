@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include "multi_idx/multi_idx.hpp"
+#include "multi_idx/multi_idx_red.hpp"
+#include "multi_idx/linear_scan.hpp"
+#include "multi_idx/tuple_foreach.hpp"
+#include "multi_idx/checksum.hpp"
+
+namespace multi_index {
+
+//! Checksum of the permutations and block sizes of a perm type
+template<typename t_perm>
+uint64_t perm_set_hash() {
+    checksum c;
+    for (const auto& p : t_perm::mi_perms) {
+        c.update(p.data(), p.size());
+    }
+    c.update(t_perm::mi_permute_block_sizes.data(), t_perm::mi_permute_block_sizes.size());
+    return c.value();
+}
+
+/*! Parameters of an index type which are not members of the type itself.
+ *  perm_hash() identifies the permutations the index is built with.
+ *  splitter_bits is the largest number of splitter bits of a permutation;
+ *  the bucket directories of the strategies have 2^splitter_bits entries.
+ */
+template<typename t_index>
+struct index_traits;
+
+template<typename t_strat, uint8_t t_k, uint8_t t_b>
+struct index_traits<multi_idx<t_strat, t_k, t_b>> {
+    static constexpr uint8_t blocks = t_b;
+    static constexpr uint8_t block_errors = 0;
+    static constexpr uint8_t splitter_bits = max_splitter_bits<typename perm_type_gen<
+        std::tuple_size<decltype(multi_idx<t_strat, t_k, t_b>::perm_b_k::mi_perms)>::value, t_b, t_k, t_strat>::type>::value;
+    static uint64_t perm_hash() { return perm_set_hash<typename multi_idx<t_strat, t_k, t_b>::perm_b_k>(); }
+};
+
+template<typename t_strat, uint8_t t_k, uint8_t t_block_errors>
+struct index_traits<multi_idx_red<t_strat, t_k, t_block_errors>> {
+    static constexpr uint8_t blocks = multi_idx_red<t_strat, t_k, t_block_errors>::t_b;
+    static constexpr uint8_t block_errors = t_block_errors;
+    static constexpr uint8_t splitter_bits = max_splitter_bits<typename perm_type_gen<
+        std::tuple_size<decltype(multi_idx_red<t_strat, t_k, t_block_errors>::perm_b_k::mi_perms)>::value, blocks, 1, t_strat,
+        typename multi_idx_red<t_strat, t_k, t_block_errors>::perm_b_k>::type>::value;
+    static uint64_t perm_hash() { return perm_set_hash<typename multi_idx_red<t_strat, t_k, t_block_errors>::perm_b_k>(); }
+};
+
+template<uint8_t t_k>
+struct index_traits<linear_scan<t_k>> {
+    static constexpr uint8_t blocks = 0;
+    static constexpr uint8_t block_errors = 0;
+    static constexpr uint8_t splitter_bits = 0;
+    static uint64_t perm_hash() { return 0; } // no permutations
+};
+
+//! Entry of an index registry: the index type and the id of its strategy
+template<typename t_index>
+struct registry_entry {
+    typedef t_index index_type;
+    static constexpr uint8_t k = t_index::k;
+    static constexpr uint8_t blocks = index_traits<t_index>::blocks;
+    static constexpr uint8_t block_errors = index_traits<t_index>::block_errors;
+
+    const char* strategy;
+};
+
+template<typename t_index>
+constexpr uint8_t registry_entry<t_index>::k;
+
+template<typename t_index>
+constexpr uint8_t registry_entry<t_index>::blocks;
+
+template<typename t_index>
+constexpr uint8_t registry_entry<t_index>::block_errors;
+
+template<typename t_index>
+constexpr registry_entry<t_index> register_index(const char* strategy) {
+    return {strategy};
+}
+
+/*! Index types of multi_idx_tool. An entry is identified by its strategy
+ *  id and k; the ids are the ones of exp0.config and exp1.config. Every
+ *  entry is compiled into the tool, so add an entry to support a new
+ *  combination.
+ */
+inline const auto& index_registry() {
+    static const auto registry = std::make_tuple(
+        register_index<multi_idx<simple_buckets_binsearch, 2>>("mi_bs"),
+        register_index<multi_idx<simple_buckets_binsearch, 3>>("mi_bs"),
+        register_index<multi_idx<simple_buckets_binsearch, 4>>("mi_bs"),
+        register_index<multi_idx<simple_buckets_binsearch, 5>>("mi_bs"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 2>>("mi_bs_red"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 4>>("mi_bs_red"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 5>>("mi_bs_red"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 3, 2>>("mi_bs_red2"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 4, 2>>("mi_bs_red2"),
+        register_index<multi_idx_red<simple_buckets_binsearch, 5, 2>>("mi_bs_red2"),
+        register_index<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv"),
+        register_index<multi_idx<simple_buckets_binvector<>, 4>>("mi_bv"),
+        register_index<multi_idx<simple_buckets_binvector<>, 5>>("mi_bv"),
+        register_index<multi_idx_red<simple_buckets_binvector<>, 3>>("mi_bv_red"),
+        register_index<multi_idx_red<simple_buckets_binvector<>, 4>>("mi_bv_red"),
+        register_index<multi_idx_red<simple_buckets_binvector<>, 5>>("mi_bv_red"),
+        register_index<multi_idx<simple_buckets_binvector_split<>, 3>>("mi_bv_split"),
+        register_index<multi_idx<simple_buckets_binvector_split<>, 4>>("mi_bv_split"),
+        register_index<multi_idx<simple_buckets_binvector_split<>, 5>>("mi_bv_split"),
+        register_index<multi_idx_red<simple_buckets_binvector_split<>, 3>>("mi_bv_split_red"),
+        register_index<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red"),
+        register_index<multi_idx_red<simple_buckets_binvector_split<>, 5>>("mi_bv_split_red"),
+        register_index<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef"),
+        register_index<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 4>>("mi_bv_split_ef"),
+        register_index<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 5>>("mi_bv_split_ef"),
+        register_index<multi_idx_red<simple_buckets_binvector_split<ef_bucket_vector>, 4>>("mi_bv_split_red_ef"),
+        register_index<multi_idx_red<simple_buckets_binvector_split<ef_bucket_vector>, 5>>("mi_bv_split_red_ef"),
+        register_index<multi_idx<simple_buckets_binvector_split_xor<>, 3>>("mi_bv_split_xor"),
+        register_index<multi_idx<simple_buckets_binvector_split_xor<>, 4>>("mi_bv_split_xor"),
+        register_index<multi_idx<xor_buckets_binvector_split<>, 3>>("mi_xor"),
+        register_index<multi_idx<xor_buckets_binvector_split<>, 4>>("mi_xor"),
+        register_index<multi_idx<triangle_buckets_binvector_split_simd<>, 3>>("mi_tri_simd"),
+        register_index<multi_idx<triangle_buckets_binvector_split_simd<>, 4>>("mi_tri_simd"),
+        register_index<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl"),
+        register_index<multi_idx<triangle_clusters_binvector_split<>, 4>>("mi_tricl"),
+        register_index<multi_idx<triangle_clusters_binvector_split_threshold<>, 3>>("mi_tricl_thres"),
+        register_index<multi_idx<triangle_clusters_binvector_split_threshold<>, 4>>("mi_tricl_thres"),
+        register_index<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive"),
+        register_index<multi_idx<adaptive_buckets_binvector_split<>, 4>>("mi_adaptive"),
+        register_index<multi_idx_red<adaptive_buckets_binvector_split<>, 4>>("mi_adaptive_red"),
+        register_index<multi_idx_red<adaptive_buckets_binvector_split<>, 5>>("mi_adaptive_red"),
+        register_index<linear_scan<2>>("linear_scan"),
+        register_index<linear_scan<3>>("linear_scan"),
+        register_index<linear_scan<4>>("linear_scan"),
+        register_index<linear_scan<5>>("linear_scan")
+    );
+    return registry;
+}
+
+/*! Calls f(entry) for the registry entry with the given strategy id and k.
+ *  \return False if there is no such entry.
+ *  \par f is instantiated for every entry, so that the code it runs for the
+ *       selected entry is compiled for the concrete index type.
+ */
+template<typename t_registry, typename t_f>
+bool dispatch_index(const t_registry& registry, const std::string& strategy, uint64_t k, t_f&& f) {
+    bool found = false;
+    auto select = [&](const auto& entry, size_t) {
+        if ( !found and strategy == entry.strategy and k == entry.k ) {
+            found = true;
+            f(entry);
+        }
+    };
+    tuple_foreach(registry, select);
+    return found;
+}
+
+//! Calls f(entry) for every registry entry
+template<typename t_registry, typename t_f>
+void for_each_index(const t_registry& registry, t_f&& f) {
+    auto call = [&](const auto& entry, size_t) { f(entry); };
+    tuple_foreach(registry, call);
+}
+
+}
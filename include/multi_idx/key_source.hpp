@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sdsl/int_vector.hpp"
+
+namespace multi_index {
+
+/*! Input keys and optional payloads of an index construction.
+ *
+ *  The keys are either held in memory or stored in a file of 64-bit
+ *  integers in plain format, like the hash files of multi_idx_tool. A file
+ *  is read in sequential passes through sdsl::int_vector_buffer and is
+ *  never materialised. The budget of a file source bounds the scratch
+ *  memory of a construction: read buffers, bucket histograms and the keys
+ *  of a pass (see bucket_scatter). Equal keys in a file are not merged;
+ *  each one is an entry of its own, like a key with several payloads.
+ */
+class key_source {
+    private:
+        const std::vector<uint64_t>* m_keys = nullptr;
+        const std::vector<uint64_t>* m_payloads = nullptr;
+        std::string m_key_file;
+        std::string m_payload_file;
+        uint64_t    m_n = 0;
+        uint64_t    m_budget_bytes = 0;
+        uint64_t    m_buffer_bytes = 0;
+
+    public:
+        //! Keys and payloads in memory; payloads is empty or has one entry per key
+        explicit key_source(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& payloads={}) :
+            m_keys(&keys), m_payloads(&payloads), m_n(keys.size()) {}
+
+        /*! Keys and payloads in files.
+         *  \param key_file     File of keys.
+         *  \param payload_file File of payloads with one entry per key or "".
+         *  \param budget_bytes Scratch memory of a construction; an eighth of
+         *                     it is used for the buffers of the int_vector_buffers.
+         */
+        explicit key_source(const std::string& key_file, const std::string& payload_file="", uint64_t budget_bytes=1ULL<<26) :
+            m_key_file(key_file), m_payload_file(payload_file), m_budget_bytes(budget_bytes) {
+            m_buffer_bytes = std::max((uint64_t)1<<12, budget_bytes / (payload_file.empty() ? 8 : 16));
+            sdsl::int_vector_buffer<64> key_buf(m_key_file, std::ios::in, m_buffer_bytes, 64, true);
+            m_n = key_buf.size();
+            if ( !m_payload_file.empty() ) {
+                sdsl::int_vector_buffer<64> payload_buf(m_payload_file, std::ios::in, m_buffer_bytes, 64, true);
+                if ( payload_buf.size() != m_n ) {
+                    std::cout << "ERROR: " << m_payload_file << " has " << payload_buf.size() << " payloads for "
+                              << m_n << " keys; payloads are ignored." << std::endl;
+                    m_payload_file.clear();
+                }
+            }
+        }
+
+        uint64_t size() const { return m_n; }
+
+        bool in_memory() const { return m_keys != nullptr; }
+
+        //! Scratch memory of a construction from a file, without the buffers of the int_vector_buffers
+        uint64_t budget() const { return m_budget_bytes - std::min(m_budget_bytes, m_buffer_bytes*(has_payloads() ? 2 : 1)); }
+
+        //! Prefix of temporary files of a construction from a file
+        std::string temp_prefix() const { return m_key_file + ".tmp"; }
+
+        bool has_payloads() const {
+            return in_memory() ? !m_payloads->empty() : !m_payload_file.empty();
+        }
+
+        //! Keys of an in-memory source
+        const std::vector<uint64_t>& keys() const { return *m_keys; }
+
+        //! Payloads of an in-memory source
+        const std::vector<uint64_t>& payloads() const { return *m_payloads; }
+
+        //! Calls f(key, payload) for all keys in input order; payload is 0 without payloads
+        template<typename t_f>
+        void for_each(t_f&& f) const {
+            const bool pay = has_payloads();
+            if ( in_memory() ) {
+                for (size_t i=0; i < m_n; ++i) {
+                    f((*m_keys)[i], pay ? (*m_payloads)[i] : 0);
+                }
+                return;
+            }
+            sdsl::int_vector_buffer<64> key_buf(m_key_file, std::ios::in, m_buffer_bytes, 64, true);
+            if ( !pay ) {
+                for (size_t i=0; i < m_n; ++i) {
+                    f(key_buf[i], 0);
+                }
+                return;
+            }
+            sdsl::int_vector_buffer<64> payload_buf(m_payload_file, std::ios::in, m_buffer_bytes, 64, true);
+            for (size_t i=0; i < m_n; ++i) {
+                f(key_buf[i], payload_buf[i]);
+            }
+        }
+
+        /*! Calls f(keys, payloads, m) for consecutive blocks of at most block
+         *  keys in input order; payloads is nullptr without payloads. Keys
+         *  of a file are copied to a buffer of block entries per array.
+         */
+        template<typename t_f>
+        void for_each_block(const uint64_t block, t_f&& f) const {
+            const bool pay = has_payloads();
+            if ( in_memory() ) {
+                for (size_t i=0; i < m_n; i += block) {
+                    f(m_keys->data()+i, pay ? m_payloads->data()+i : nullptr, std::min(block, m_n-i));
+                }
+                return;
+            }
+            sdsl::int_vector_buffer<64> key_buf(m_key_file, std::ios::in, m_buffer_bytes, 64, true);
+            std::unique_ptr<sdsl::int_vector_buffer<64>> payload_buf;
+            if ( pay ) {
+                payload_buf.reset(new sdsl::int_vector_buffer<64>(m_payload_file, std::ios::in, m_buffer_bytes, 64, true));
+            }
+            std::vector<uint64_t> keys(std::min(block, m_n)), payloads(pay ? keys.size() : 0);
+            for (size_t i=0; i < m_n; i += block) {
+                const size_t m = std::min(block, m_n-i);
+                for (size_t j=0; j < m; ++j) {
+                    keys[j] = key_buf[i+j];
+                    if ( pay ) payloads[j] = (*payload_buf)[i+j];
+                }
+                f(keys.data(), pay ? payloads.data() : nullptr, m);
+            }
+        }
+
+        //! Largest payload (0 without payloads)
+        uint64_t max_payload() const {
+            uint64_t max = 0;
+            if ( !has_payloads() ) return max;
+            if ( in_memory() ) {
+                return *std::max_element(m_payloads->begin(), m_payloads->end());
+            }
+            for_each([&](uint64_t, uint64_t p) { max = std::max(max, p); });
+            return max;
+        }
+};
+
+}
@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <vector>
 #include "sdsl/io.hpp"
+#include "multi_idx/key_source.hpp"
+#include "multi_idx/thread_pool.hpp"
 
 namespace multi_index {
 
@@ -10,6 +12,7 @@ template<uint8_t t_k=3>
 class linear_scan {
     public:    
         typedef uint64_t size_type;
+        static constexpr uint8_t k = t_k; // number of allowed errors
     private:
         std::vector<uint64_t> m_keys;
 
@@ -28,11 +31,25 @@ class linear_scan {
             m_keys = keys;  
         }
 
-        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) {
+        //! Copies the keys of a key source (see key_source)
+        explicit linear_scan(const key_source& keys) {
+            m_keys.reserve(keys.size());
+            keys.for_each([&](uint64_t x, uint64_t) { m_keys.push_back(x); });
+        }
+
+        //! Copies the keys of a key source; a copy gains nothing from threads
+        linear_scan(const key_source& keys, thread_pool&) : linear_scan(keys) {}
+
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) const {
+            return match(query, t_k, find_only_candidates);
+        }
+
+        //! Returns all keys within distance radius of query
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const int radius, const bool find_only_candidates=false) const {
             std::vector<uint64_t> matches;
             uint64_t candidates = 0;
             for(auto it = m_keys.begin(); it!=m_keys.end(); ++it){
-                if ( sdsl::bits::cnt((*it)^query) < t_k ) {
+                if ( (int)sdsl::bits::cnt((*it)^query) <= radius ) {
                     matches.push_back(*it);
                 }
             }
@@ -40,23 +57,69 @@ class linear_scan {
             return {matches, candidates};
         }
 
+        //! Appends the keys within distance radius of query to out and returns the number of candidates
+        uint64_t match(const uint64_t query, std::vector<uint64_t>& out, const int radius=t_k) const {
+            return visit(query, [&](uint64_t key){ out.push_back(key); }, radius);
+        }
+
+        //! Calls report(key) for each key within distance radius of query and returns the number of candidates
+        template<typename t_report>
+        uint64_t visit(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            for(auto it = m_keys.begin(); it!=m_keys.end(); ++it){
+                if ( (int)sdsl::bits::cnt((*it)^query) <= radius ) {
+                    report(*it);
+                }
+            }
+            return m_keys.size();
+        }
+
+        //! Like match; the keys are distinct, so each match is reported once
+        std::pair<std::vector<uint64_t>,uint64_t> match_unique(const uint64_t query, const int radius=t_k) const {
+            return match(query, radius);
+        }
+
+        //! Like visit; the keys are distinct, so each match is reported once
+        template<typename t_report>
+        uint64_t visit_unique(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            return visit(query, report, radius);
+        }
+
+        //! Number of keys within distance radius of query
+        uint64_t count(const uint64_t query, const int radius=t_k) const {
+            uint64_t cnt = 0;
+            for(auto it = m_keys.begin(); it!=m_keys.end(); ++it){
+                cnt += (int)sdsl::bits::cnt((*it)^query) <= radius;
+            }
+            return cnt;
+        }
+
+        //! True if a key within distance radius of query exists
+        bool exists(const uint64_t query, const int radius=t_k) const {
+            for(auto it = m_keys.begin(); it!=m_keys.end(); ++it){
+                if ( (int)sdsl::bits::cnt((*it)^query) <= radius ) return true;
+            }
+            return false;
+        }
+
         //! Serializes the data structure into the given ostream
         uint64_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr,
                           std::string name = "") const {
             using namespace sdsl;
             structure_tree_node *child =
                 structure_tree::add_child(v, name, util::class_name(*this));
-            structure_tree::add_size(child, 0);
-            return 0;
+            uint64_t written_bytes = write_member((uint64_t)m_keys.size(), out, child, "size");
+            out.write((const char*) m_keys.data(), m_keys.size()*sizeof(uint64_t));
+            written_bytes += m_keys.size()*sizeof(uint64_t);
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
         }
 
         //! Loads the data structure from the given istream.
         void load(std::istream &in) {
-            uint64_t x;
-            m_keys.clear();
-            while(in.read((char*) &x,sizeof(x))){
-                m_keys.push_back(x);
-            }
+            uint64_t n = 0;
+            sdsl::read_member(n, in);
+            m_keys.resize(n);
+            in.read((char*) m_keys.data(), n*sizeof(uint64_t));
             std::cout<<"loaded "<<m_keys.size()<<" keys"<<std::endl;
         }
 
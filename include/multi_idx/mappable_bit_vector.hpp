@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "sdsl/io.hpp"
+#include "sdsl/int_vector.hpp"
+#include "multi_idx/mmap_io.hpp"
+
+namespace multi_index {
+
+/*! Bucket bit vector m_C whose bits and select structure can be mapped.
+ *
+ *  m_C has 2^splitter_bits+n bits, e.g. 128 MB per permutation for 10^9
+ *  keys and 512 MB for 32 splitter bits. An sdsl::bit_vector and its
+ *  select_support_mcl are copied into memory on every load. This class
+ *  keeps the bits and a select directory in mappable_int_vectors, so that
+ *  load_from_file_mapped maps all of it:
+ *      - m_block_ones: number of ones before each block of block_words
+ *        words, plus the total number of ones,
+ *      - m_hints: block of every hint_rate-th one.
+ *  select_1(i) binary searches the few blocks between the two hints
+ *  around i and selects in a single block. The directory adds 64 bits per
+ *  512 bits and 32 bits per hint_rate ones (so at most 2^41 bits).
+ *
+ *  \par The class provides the part of the sdsl::bit_vector interface
+ *       which the bucket strategies use, like ef_bucket_vector. The bits
+ *       are written before the select structure is built, which is when a
+ *       select_1_type or rank_1_type is attached; afterwards the vector is
+ *       read-only.
+ */
+class mappable_bit_vector {
+    public:
+        typedef uint64_t size_type;
+        static constexpr uint64_t block_words = 8;    // one cache line
+        static constexpr uint64_t block_bits  = 64*block_words;
+        static constexpr uint64_t hint_rate   = 256;  // ones per hint
+
+        class reference;
+        class select_1_type;
+        class rank_1_type;
+
+    private:
+        uint64_t                m_size = 0;
+        uint64_t                m_ones = 0;
+        mappable_int_vector<64> m_bits;
+        mappable_int_vector<64> m_block_ones; // ones before each block; the last entry holds m_ones
+        mappable_int_vector<32> m_hints;      // block of the (j*hint_rate+1)-th one
+        bool                    m_final = false;
+
+    public:
+        mappable_bit_vector() = default;
+
+        //! Vector of n bits with value value; write it with operator[] before attaching a select_1_type
+        explicit mappable_bit_vector(size_type n, bool value=false) : m_size(n), m_final(false) {
+            sdsl::int_vector<64> bits((n+63)/64, value ? ~0ULL : 0ULL);
+            if ( value and (n & 63) ) bits[bits.size()-1] = sdsl::bits::lo_set[n & 63];
+            m_bits = std::move(bits);
+        }
+
+        class reference {
+            private:
+                mappable_bit_vector* m_v;
+                uint64_t             m_i;
+            public:
+                reference(mappable_bit_vector* v, uint64_t i) : m_v(v), m_i(i) {}
+                reference& operator=(uint64_t x) {
+                    m_v->set(m_i, x != 0);
+                    return *this;
+                }
+                operator bool() const { return (*(const mappable_bit_vector*)m_v)[m_i]; }
+        };
+
+        reference operator[](size_type i) { return reference(this, i); }
+
+        bool operator[](size_type i) const {
+            return (m_bits.data()[i >> 6] >> (i & 63)) & 1ULL;
+        }
+
+        size_type size() const { return m_size; }
+        const uint64_t* data() const { return m_bits.data(); }
+
+        //! True if the bits live in a memory mapping
+        bool is_mapped() const { return m_bits.is_mapped(); }
+
+        //! Position of the i-th one, 1 <= i <= number of ones
+        uint64_t select_1(uint64_t i) const {
+            const uint64_t j = (i-1) / hint_rate;
+            uint64_t lo = m_hints[j];
+            uint64_t hi = j+1 < m_hints.size() ? m_hints[j+1] : m_block_ones.size()-2;
+            while ( lo < hi ) { // last block with fewer than i ones before it
+                const uint64_t mid = lo + (hi-lo+1)/2;
+                if ( m_block_ones[mid] < i ) lo = mid; else hi = mid-1;
+            }
+            uint64_t rest = i - m_block_ones[lo];
+            for (uint64_t w = lo*block_words; ; ++w) {
+                const uint64_t word = m_bits[w];
+                const uint64_t c = sdsl::bits::cnt(word);
+                if ( rest <= c ) return (w << 6) + sdsl::bits::sel(word, rest);
+                rest -= c;
+            }
+        }
+
+        //! Number of ones in [0, p)
+        uint64_t rank_1(uint64_t p) const {
+            const uint64_t last = p >> 6;
+            uint64_t w = (p / block_bits) * block_words;
+            uint64_t ones = m_block_ones[p / block_bits];
+            for (; w < last; ++w) {
+                ones += sdsl::bits::cnt(m_bits[w]);
+            }
+            if ( p & 63 ) ones += sdsl::bits::cnt(m_bits[last] & sdsl::bits::lo_set[p & 63]);
+            return ones;
+        }
+
+        //! Serializes the data structure into the given ostream
+        size_type serialize(std::ostream& out, sdsl::structure_tree_node* v=nullptr, std::string name="") const {
+            using namespace sdsl;
+            finalize();
+            structure_tree_node* child = structure_tree::add_child(v, name, util::class_name(*this));
+            uint64_t written_bytes = 0;
+            written_bytes += write_member(m_size, out, child, "size");
+            written_bytes += write_member(m_ones, out, child, "ones");
+            written_bytes += m_bits.serialize(out, child, "bits");
+            written_bytes += m_block_ones.serialize(out, child, "block_ones");
+            written_bytes += m_hints.serialize(out, child, "hints");
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        //! Loads the data structure from the given istream.
+        void load(std::istream& in) {
+            sdsl::read_member(m_size, in);
+            sdsl::read_member(m_ones, in);
+            m_bits.load(in);
+            m_block_ones.load(in);
+            m_hints.load(in);
+            m_final = true;
+        }
+
+        //! Builds the select directory of the written bits; afterwards the vector is read-only
+        void finalize() const {
+            if ( !m_final ) const_cast<mappable_bit_vector*>(this)->build();
+        }
+
+    private:
+        void set(uint64_t i, bool x) {
+            if ( m_final ) throw std::logic_error("mappable_bit_vector: bits have to be written before the select structure is built");
+            const uint64_t mask = 1ULL << (i & 63);
+            m_bits[i >> 6] = x ? (m_bits[i >> 6] | mask) : (m_bits[i >> 6] & ~mask);
+        }
+
+        void build() {
+            const uint64_t* bits = m_bits.data();
+            const uint64_t words = m_bits.size();
+            const uint64_t blocks = (words + block_words-1) / block_words;
+            sdsl::int_vector<64> block_ones(blocks+1, 0);
+            std::vector<uint64_t> hints;
+            uint64_t ones = 0;
+            for (uint64_t w = 0; w < words; ++w) {
+                if ( w % block_words == 0 ) block_ones[w / block_words] = ones;
+                const uint64_t c = sdsl::bits::cnt(bits[w]);
+                while ( hints.size()*hint_rate < ones + c ) hints.push_back(w / block_words);
+                ones += c;
+            }
+            block_ones[blocks] = ones;
+            sdsl::int_vector<32> hint_vec(hints.size(), 0);
+            for (size_t j = 0; j < hints.size(); ++j) hint_vec[j] = hints[j];
+            m_ones = ones;
+            m_block_ones = std::move(block_ones);
+            m_hints = std::move(hint_vec);
+            m_final = true;
+        }
+
+    public:
+        class select_1_type {
+            private:
+                const mappable_bit_vector* m_v = nullptr;
+            public:
+                select_1_type(const mappable_bit_vector* v=nullptr) { set_vector(v); }
+                void set_vector(const mappable_bit_vector* v) {
+                    m_v = v;
+                    if ( m_v != nullptr ) m_v->finalize();
+                }
+                uint64_t operator()(uint64_t i) const { return m_v->select_1(i); }
+                // The directory is part of the vector
+                size_type serialize(std::ostream&, sdsl::structure_tree_node* =nullptr, std::string="") const { return 0; }
+                void load(std::istream&, const mappable_bit_vector* v=nullptr) { set_vector(v); }
+        };
+
+        class rank_1_type {
+            private:
+                const mappable_bit_vector* m_v = nullptr;
+            public:
+                rank_1_type(const mappable_bit_vector* v=nullptr) { set_vector(v); }
+                void set_vector(const mappable_bit_vector* v) {
+                    m_v = v;
+                    if ( m_v != nullptr ) m_v->finalize();
+                }
+                uint64_t operator()(uint64_t p) const { return m_v->rank_1(p); }
+                size_type serialize(std::ostream&, sdsl::structure_tree_node* =nullptr, std::string="") const { return 0; }
+                void load(std::istream&, const mappable_bit_vector* v=nullptr) { set_vector(v); }
+        };
+};
+
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sdsl/int_vector.hpp"
+#include "sdsl/io.hpp"
+
+namespace multi_index {
+
+//! Alignment of the packed arrays in a serialized index
+constexpr uint64_t mmap_page_size = 4096;
+
+//! Read-only memory mapping of a whole file
+class mmap_file {
+    private:
+        const char* m_data = nullptr;
+        uint64_t    m_size = 0;
+
+    public:
+        mmap_file() = default;
+        mmap_file(const mmap_file&) = delete;
+        mmap_file& operator=(const mmap_file&) = delete;
+
+        ~mmap_file() {
+            close();
+        }
+
+        bool open(const std::string& file) {
+            close();
+            int fd = ::open(file.c_str(), O_RDONLY);
+            if ( fd < 0 ) return false;
+            struct stat st;
+            if ( fstat(fd, &st) != 0 or st.st_size == 0 ) {
+                ::close(fd);
+                return false;
+            }
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd); // the mapping keeps the file alive
+            if ( p == MAP_FAILED ) return false;
+            m_data = (const char*)p;
+            m_size = st.st_size;
+            return true;
+        }
+
+        void close() {
+            if ( m_data != nullptr ) {
+                munmap((void*)m_data, m_size);
+                m_data = nullptr;
+                m_size = 0;
+            }
+        }
+
+        const char* data() const { return m_data; }
+        uint64_t size() const { return m_size; }
+};
+
+/*! istream over a memory mapping.
+ *  Ordinary members are copied out of the mapping by the usual load
+ *  methods. A mappable_int_vector detects this stream type and points
+ *  directly into the mapping instead of copying its data.
+ */
+class mmap_istream : public std::istream {
+    private:
+        class mmap_buf : public std::streambuf {
+            public:
+                mmap_buf(const char* data, uint64_t size) {
+                    char* p = const_cast<char*>(data); // never written
+                    setg(p, p, p+size);
+                }
+
+                const char* current() const { return gptr(); }
+
+                void advance(uint64_t n) {
+                    setg(eback(), gptr()+n, egptr());
+                }
+
+            protected:
+                pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+                    const char* base = dir == std::ios_base::beg ? eback() : (dir == std::ios_base::cur ? gptr() : egptr());
+                    return seekpos((base - eback()) + off, std::ios_base::in);
+                }
+
+                pos_type seekpos(pos_type pos, std::ios_base::openmode) override {
+                    if ( pos < 0 or pos > egptr() - eback() ) return pos_type(off_type(-1));
+                    setg(eback(), eback()+pos, egptr());
+                    return pos;
+                }
+        };
+
+        mmap_buf m_buf;
+
+    public:
+        explicit mmap_istream(const mmap_file& file) : std::istream(nullptr), m_buf(file.data(), file.size()) {
+            rdbuf(&m_buf);
+        }
+
+        //! Pointer to the current read position in the mapping
+        const char* current() const { return m_buf.current(); }
+
+        //! Skips n bytes
+        void advance(uint64_t n) { m_buf.advance(n); }
+};
+
+/*! An sdsl::int_vector whose data can also live in a memory mapping.
+ *
+ *  The vector is built and written like an sdsl::int_vector. When loaded
+ *  from an mmap_istream it only keeps a pointer into the mapping. The
+ *  serialized data is page-aligned for this purpose:
+ *      [size][width][padding bytes p][p zero bytes][data words]
+ *  Mapped vectors are read-only. Random access works for all widths; for
+ *  widths 8, 16, 32 and 64, begin()/end() return plain pointers.
+ */
+template<uint8_t t_width=0>
+class mappable_int_vector {
+    public:
+        typedef sdsl::int_vector<t_width>                    vector_type;
+        typedef typename vector_type::value_type             value_type;
+        typedef typename vector_type::size_type              size_type;
+        typedef typename std::conditional<t_width==8, uint8_t,
+                typename std::conditional<t_width==16, uint16_t,
+                typename std::conditional<t_width==32, uint32_t, uint64_t>::type>::type>::type elem_type;
+        typedef const elem_type*                             const_iterator;
+
+    private:
+        vector_type     m_vec;                // owned data (empty if mapped)
+        const uint64_t* m_data = nullptr;     // data words, owned or mapped
+        size_type       m_size = 0;
+        uint8_t         m_w    = t_width;
+
+        static uint64_t words(size_type n, uint8_t w) {
+            return (n*w+63)/64;
+        }
+
+        void attach() {
+            m_data = m_vec.data();
+            m_size = m_vec.size();
+            m_w    = m_vec.width();
+        }
+
+    public:
+        mappable_int_vector() { attach(); }
+        mappable_int_vector(size_type n, value_type x=0, uint8_t w=t_width) : m_vec(n, x, w) { attach(); }
+        mappable_int_vector(vector_type&& v) : m_vec(std::move(v)) { attach(); }
+        mappable_int_vector(const vector_type& v) : m_vec(v) { attach(); }
+
+        mappable_int_vector(const mappable_int_vector& v) : m_vec(v.m_vec), m_data(v.m_data), m_size(v.m_size), m_w(v.m_w) {
+            if ( !v.is_mapped() ) attach();
+        }
+
+        // swap decides is_mapped() of both sides before their vectors move
+        mappable_int_vector(mappable_int_vector&& v) : mappable_int_vector() {
+            swap(v);
+        }
+
+        mappable_int_vector& operator=(const mappable_int_vector& v) {
+            if ( this != &v ) {
+                mappable_int_vector tmp(v);
+                swap(tmp);
+            }
+            return *this;
+        }
+
+        mappable_int_vector& operator=(mappable_int_vector&& v) {
+            if ( this != &v ) {
+                mappable_int_vector tmp(std::move(v));
+                swap(tmp);
+            }
+            return *this;
+        }
+
+        void swap(mappable_int_vector& v) {
+            const bool mapped = is_mapped(), v_mapped = v.is_mapped();
+            m_vec.swap(v.m_vec);
+            std::swap(m_data, v.m_data);
+            std::swap(m_size, v.m_size);
+            std::swap(m_w, v.m_w);
+            if ( !v_mapped ) attach();
+            if ( !mapped ) v.attach();
+        }
+
+        //! True if the data lives in a memory mapping
+        bool is_mapped() const {
+            return m_data != nullptr and m_data != m_vec.data();
+        }
+
+        size_type size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        uint8_t width() const { return m_w; }
+        const uint64_t* data() const { return m_data; }
+
+        value_type operator[](size_type i) const {
+            if ( t_width == 8 or t_width == 16 or t_width == 32 or t_width == 64 ) {
+                return ((const elem_type*)m_data)[i];
+            }
+            return sdsl::bits::read_int(m_data + ((i*m_w)>>6), (i*m_w)&0x3F, m_w);
+        }
+
+        //! Write access to the owned vector; throws std::logic_error if the vector is mapped
+        typename vector_type::reference operator[](size_type i) {
+            if ( is_mapped() ) throw std::logic_error("mappable_int_vector: a mapped vector is read-only");
+            return m_vec[i];
+        }
+
+        const_iterator begin() const {
+            static_assert(t_width == 8 or t_width == 16 or t_width == 32 or t_width == 64, "begin() requires a byte-aligned width");
+            return (const elem_type*)m_data;
+        }
+
+        const_iterator end() const {
+            return begin() + m_size;
+        }
+
+        //! Mutable iterators of the owned vector; throw std::logic_error if the vector is mapped
+        typename vector_type::iterator begin() {
+            if ( is_mapped() ) throw std::logic_error("mappable_int_vector: a mapped vector is read-only");
+            return m_vec.begin();
+        }
+        typename vector_type::iterator end() {
+            if ( is_mapped() ) throw std::logic_error("mappable_int_vector: a mapped vector is read-only");
+            return m_vec.end();
+        }
+
+        size_type serialize(std::ostream& out, sdsl::structure_tree_node* v=nullptr, std::string name="") const {
+            using namespace sdsl;
+            structure_tree_node* child = structure_tree::add_child(v, name, util::class_name(*this));
+            size_type written_bytes = 0;
+            written_bytes += write_member((uint64_t)m_size, out, child, "size");
+            written_bytes += write_member((uint64_t)m_w, out, child, "width");
+            // Pad such that the data starts at a page boundary of the file
+            uint64_t padding = 0;
+            const auto pos = out.tellp();
+            if ( pos >= 0 ) {
+                padding = (mmap_page_size - ((uint64_t)pos + sizeof(uint64_t)) % mmap_page_size) % mmap_page_size;
+            }
+            written_bytes += write_member(padding, out, child, "padding");
+            const char zeros[mmap_page_size] = {};
+            out.write(zeros, padding);
+            written_bytes += padding;
+            out.write((const char*)m_data, words(m_size, m_w)*sizeof(uint64_t));
+            written_bytes += words(m_size, m_w)*sizeof(uint64_t);
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        void load(std::istream& in) {
+            uint64_t n = 0, w = 0, padding = 0;
+            sdsl::read_member(n, in);
+            sdsl::read_member(w, in);
+            sdsl::read_member(padding, in);
+            in.seekg(padding, std::ios_base::cur);
+            const uint64_t bytes = words(n, w)*sizeof(uint64_t);
+            mmap_istream* mapped_in = dynamic_cast<mmap_istream*>(&in);
+            if ( mapped_in != nullptr and ((size_t)mapped_in->current()) % sizeof(uint64_t) == 0 ) {
+                m_vec  = vector_type();
+                m_data = (const uint64_t*)mapped_in->current();
+                m_size = n;
+                m_w    = w;
+                mapped_in->advance(bytes);
+            } else {
+                m_vec = vector_type(n, 0, w);
+                in.read((char*)m_vec.data(), bytes);
+                attach();
+            }
+        }
+};
+
+/*! Loads idx from file without copying the packed arrays.
+ *  \param map Mapping of the file; it has to outlive idx.
+ */
+template<typename t_index>
+bool load_from_file_mapped(t_index& idx, mmap_file& map, const std::string& file) {
+    if ( !map.open(file) ) {
+        return false;
+    }
+    mmap_istream in(map);
+    idx.load(in);
+    return (bool)in;
+}
+
+/*! Writes idx to file and replaces it by a copy mapped from the file, so
+ *  that its packed arrays no longer take memory. The file is removed again;
+ *  the mapping lives as long as the returned pointer, which has to outlive
+ *  idx. If the file cannot be written, idx stays in memory and the result
+ *  is nullptr.
+ */
+template<typename t_index>
+std::shared_ptr<mmap_file> spill_to_mapped_file(t_index& idx, const std::string& file) {
+    bool written = false;
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        if ( out ) {
+            idx.serialize(out);
+            written = (bool)out;
+        }
+    }
+    auto map = std::make_shared<mmap_file>();
+    t_index mapped;
+    const bool loaded = written and load_from_file_mapped(mapped, *map, file);
+    std::remove(file.c_str()); // the mapping keeps the data
+    if ( !loaded ) {
+        std::cout << "ERROR: Could not write " << file << "; the index is kept in memory." << std::endl;
+        return nullptr;
+    }
+    idx = std::move(mapped);
+    return map;
+}
+
+}
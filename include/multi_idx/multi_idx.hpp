@@ -1,10 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
-#include <future>
 #include "sdsl/io.hpp"
 #include "multi_idx/perm.hpp"
+#include "multi_idx/key_source.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/thread_pool.hpp"
 #include "multi_idx/tuple_foreach.hpp"
 #include "multi_idx/multi_idx_helper.hpp"
 #include "multi_idx/simple_buckets_binsearch.hpp"
@@ -17,6 +21,8 @@
 #include "multi_idx/triangle_clusters_binvector_split.hpp"
 #include "multi_idx/triangle_clusters_binvector_split_threshold.hpp"
 #include "multi_idx/xor_buckets_binvector_split.hpp"
+#include "multi_idx/adaptive_buckets_binvector_split.hpp"
+#include "multi_idx/ef_bucket_vector.hpp"
 
 namespace multi_index {
 
@@ -40,9 +46,11 @@ class multi_idx {
     public:    
         typedef uint64_t          size_type;
         typedef perm<t_b,t_b-t_k> perm_b_k;
+        static constexpr uint8_t  k = t_k; // number of allowed errors
     private:
         static constexpr size_t m_num_perms = std::tuple_size<decltype(perm_b_k::mi_perms)>::value;
         typename perm_type_gen<m_num_perms, t_b, t_k, t_idx_strategy>::type m_idx;
+        std::vector<std::shared_ptr<mmap_file>> m_maps; // files of the permutations of a construction from a file
 
     public:
         multi_idx() = default;
@@ -55,19 +63,172 @@ class multi_idx {
         *  \param keys  Vector of hash values
         *  \pre Items are all different (no duplicates)
         */
-        multi_idx(const std::vector<uint64_t>& keys, bool async=false) {
-            constructor c{keys, async};
+        multi_idx(const std::vector<uint64_t>& keys, bool async=false) : multi_idx(keys, {}, async) {}
+
+        /*!
+        *  \param keys      Vector of hash values
+        *  \param payloads  payloads[i] is reported for a match of keys[i]
+        *                   by match_payloads, e.g. a document id.
+        *  \param async     Build with all hardware threads (see below).
+        *  \par Keys may occur several times with different payloads.
+        */
+        multi_idx(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& payloads, bool async=false) {
+            if ( async ) {
+                thread_pool pool;
+                build(key_source(keys, payloads), &pool);
+            } else {
+                build(key_source(keys, payloads), nullptr);
+            }
+        }
+
+        /*! Builds the index with the threads of pool.
+        *  \par The permutations are built concurrently and each strategy
+        *       sorts its entries into buckets and clusters them in parallel.
+        *       The result is identical to a serial construction.
+        */
+        multi_idx(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& payloads, thread_pool& pool) {
+            build(key_source(keys, payloads), &pool);
+        }
+
+        /*! Builds the index from keys in memory or in a file (see key_source).
+        *  \par Keys in a file are streamed into the arrays of one permutation
+        *       after another with the scratch memory of the budget of the
+        *       source (see bucket_scatter). Each permutation is then written
+        *       to a temporary file next to the key file and mapped back, so
+        *       only the arrays of one permutation are in memory at a time.
+        *       The triangle cluster and adaptive strategies additionally
+        *       keep the permuted keys of one permutation in memory while they
+        *       cluster. Duplicates in the file are kept as separate entries.
+        */
+        explicit multi_idx(const key_source& keys) {
+            build(keys, nullptr);
+        }
+
+        //! Builds the index from keys in memory or in a file with the threads of pool
+        multi_idx(const key_source& keys, thread_pool& pool) {
+            build(keys, &pool);
+        }
+
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) const {
+            return match(query, t_k, find_only_candidates);
+        }
+
+        /*! Returns all keys within distance radius of query.
+         *  \param radius Search radius in [0, t_k]; larger values are clamped to t_k.
+         *  \par radius is an int, so that match(q, 2) does not convert 2 to
+         *       find_only_candidates. Keys within a smaller radius share
+         *       at least as many blocks with the query, so one index built
+         *       for t_k serves all radii up to t_k.
+         */
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const int radius, const bool find_only_candidates=false) const {
+            std::vector<uint64_t> matches;
+            uint64_t candidates = 0;
+            if ( find_only_candidates ) {
+                matcher m{matches, candidates, query, clamp_radius(radius), true, false};
+                tuple_foreach(m_idx, m);
+            } else {
+                candidates = match(query, matches, radius);
+            }
+            return {matches, candidates};
+        }
+
+        /*! Appends the keys within distance radius of query to out and returns
+         *  the number of candidates. The results are the same as for match.
+         *  \par Apart from the growth of out nothing is allocated, so a buffer
+         *       which is cleared and reused between queries avoids all heap
+         *       allocations of the query path.
+         */
+        uint64_t match(const uint64_t query, std::vector<uint64_t>& out, const int radius=t_k) const {
+            return visit(query, [&](uint64_t key) { out.push_back(key); }, radius);
+        }
+
+        /*! Calls report(key) for each key within distance radius of query,
+         *  in the same order and with the same duplicates as match.
+         *  \return The number of candidates.
+         */
+        template<typename t_report>
+        uint64_t visit(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            uint64_t candidates = 0;
+            visitor<t_report> v{report, candidates, query, clamp_radius(radius)};
+            tuple_foreach(m_idx, v);
+            return candidates;
+        }
+
+        /*! Like match, but reports each key within distance radius exactly once.
+         *  \par A match is only kept under the first permutation which finds
+         *       it (see splitter_cover), so no sort/unique pass over the result
+         *       is needed.
+         */
+        std::pair<std::vector<uint64_t>,uint64_t> match_unique(const uint64_t query, const int radius=t_k) const {
+            std::vector<uint64_t> matches;
+            const uint64_t candidates = visit_unique(query, [&](uint64_t key) { matches.push_back(key); }, radius);
+            return {matches, candidates};
+        }
+
+        /*! Calls report(key) for each key within distance radius of query
+         *  exactly once, in the same order as match_unique.
+         *  \return The number of candidates.
+         */
+        template<typename t_report>
+        uint64_t visit_unique(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            uint64_t candidates = 0;
+            unique_visitor<t_report> v{report, candidates, query, clamp_radius(radius), cover()};
+            tuple_foreach(m_idx, v);
+            return candidates;
+        }
+
+        /*! Number of distinct keys within distance radius of query.
+         *  \par No result vector is built and no key is reverse permuted. A
+         *       key is only counted under the first permutation which finds
+         *       it (see splitter_cover).
+         */
+        uint64_t count(const uint64_t query, const int radius=t_k) const {
+            uint64_t cnt = 0;
+            counter c{cnt, query, clamp_radius(radius), cover()};
             tuple_foreach(m_idx, c);
+            return cnt;
         }
 
-        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) {
+        //! True if a key within distance radius of query exists; stops at the first verified match
+        bool exists(const uint64_t query, const int radius=t_k) const {
+            bool found = false;
+            existence_checker e{found, query, clamp_radius(radius)};
+            tuple_foreach(m_idx, e);
+            return found;
+        }
+
+        //! Like match, but returns the payloads of the matching keys instead of the keys
+        std::pair<std::vector<uint64_t>,uint64_t> match_payloads(const uint64_t query, const bool find_only_candidates=false) const {
+            return match_payloads(query, t_k, find_only_candidates);
+        }
+
+        std::pair<std::vector<uint64_t>,uint64_t> match_payloads(const uint64_t query, const int radius, const bool find_only_candidates=false) const {
             std::vector<uint64_t> matches;
             uint64_t candidates = 0;
-            matcher m{matches, candidates, query, find_only_candidates};
+            matcher m{matches, candidates, query, clamp_radius(radius), find_only_candidates, true};
             tuple_foreach(m_idx, m);
             return {matches, candidates};
         }
 
+        /*! Matches a batch of queries.
+         *  \param queries Pointer to the first query key.
+         *  \param n       Number of queries.
+         *  \param sink    Receives the matches and candidates of query i under id i.
+         *  \param report_payloads Store the payloads of the matches instead of the keys.
+         *  \param radius  Search radius in [0, t_k] for all queries of the batch.
+         *
+         *  \par For each permutation the (sub-)queries of the batch are sorted
+         *       by bucket, so that each bucket range is located once and
+         *       scanned consecutively for all queries which hit it.
+         */
+        void match_batch(const uint64_t* queries, size_t n, result_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false, const int radius=t_k) const {
+            sink.reset(n);
+            std::vector<batch_query> batch;
+            batch_matcher m{batch, sink, queries, n, clamp_radius(radius), find_only_candidates, report_payloads};
+            tuple_foreach(m_idx, m);
+            sink.finalize();
+        }
+
         //! Serializes the data structure into the given ostream
         uint64_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr,
                           std::string name = "") const {
@@ -85,6 +246,7 @@ class multi_idx {
         void load(std::istream &in) {
             loader l{in};
             tuple_foreach(m_idx, l);
+            m_maps.clear();
         }
 
         uint64_t size() const {
@@ -94,29 +256,79 @@ class multi_idx {
             return 0;
         }
 
+        //! True if the packed arrays of all permutations live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            bool mapped = true;
+            mapped_checker c{mapped};
+            tuple_foreach(m_idx, c);
+            return mapped;
+        }
+
     private:
+        static uint8_t clamp_radius(const int radius) {
+            return (uint8_t)std::max(0, std::min((int)t_k, radius));
+        }
+
+        const splitter_cover<m_num_perms>& cover() const {
+            static const splitter_cover<m_num_perms> c(m_idx);
+            return c;
+        }
+
         // Functors which do the actual work on the tuple of indexes
 
         struct constructor {
-            const std::vector<uint64_t>& items;
-            bool is_async;
-            std::vector<std::future<int>> futures;
+            const key_source& items;
+            thread_pool* pool;
+            size_t perm; // id of the permutation to build
 
-            constructor(const std::vector<uint64_t>& f_items, bool asy=false):items(f_items),is_async(asy){};
             template <typename T>
-            void operator()(T&& t, std::size_t i)  {
-                if ( is_async ) {
-                    std::cout<<"start construction thread"<<std::endl;
-                    futures.push_back( std::async(std::launch::async,[&](){ 
-                        t = (typename std::remove_reference<T>::type){items}; 
-                        return 1;
-                    }));
-                } else {
-                    t = (typename std::remove_reference<T>::type){items}; 
+            void operator()(T&& t, std::size_t i) const {
+                if ( i == perm ) {
+                    t = (typename std::remove_reference<T>::type){items, pool};
                 }
             }
         };
 
+        struct spiller {
+            std::vector<std::shared_ptr<mmap_file>>& maps;
+            const std::string& prefix;
+            size_t perm; // id of the permutation to spill
+
+            template <typename T>
+            void operator()(T&& t, std::size_t i) const {
+                if ( i == perm ) {
+                    auto map = spill_to_mapped_file(t, prefix + std::to_string(i));
+                    if ( map ) maps.push_back(map);
+                }
+            }
+        };
+
+        void build(const key_source& keys, thread_pool* pool) {
+            m_maps.clear();
+            if ( !keys.in_memory() ) {
+                // one permutation at a time; the pool works within a permutation
+                const std::string prefix = keys.temp_prefix();
+                for (size_t i=0; i < m_num_perms; ++i) {
+                    constructor c{keys, pool, i};
+                    tuple_foreach(m_idx, c);
+                    spiller s{m_maps, prefix, i};
+                    tuple_foreach(m_idx, s);
+                }
+                return;
+            }
+            auto build_perms = [&](size_t begin, size_t end, size_t) {
+                for (size_t i=begin; i < end; ++i) {
+                    constructor c{keys, pool, i};
+                    tuple_foreach(m_idx, c);
+                }
+            };
+            if ( pool != nullptr ) {
+                pool->parallel_for(m_num_perms, 1, build_perms);
+            } else {
+                build_perms(0, m_num_perms, 0);
+            }
+        }
+
         struct serializer {
             uint64_t& wb;
             sdsl::structure_tree_node *c;
@@ -142,19 +354,117 @@ class multi_idx {
             std::vector<uint64_t>& matches;
             uint64_t& candidates;
             uint64_t query;
+            uint8_t radius;
             bool only_cands;
-            matcher(std::vector<uint64_t>& mats, uint64_t& cands, uint64_t qry, bool only_cand) : 
-                matches(mats), candidates(cands), query(qry), only_cands(only_cand) 
+            bool payloads;
+            matcher(std::vector<uint64_t>& mats, uint64_t& cands, uint64_t qry, uint8_t rad, bool only_cand, bool pay) : 
+                matches(mats), candidates(cands), query(qry), radius(rad), only_cands(only_cand), payloads(pay) 
             { };
 
             template<typename T>
             void operator()(T&& t, std::size_t i) const {
-                auto res = t.match(query, t_k, only_cands);
+                auto res = t.match(query, radius, only_cands, payloads);
                 matches.insert(matches.end(), std::get<0>(res).begin(), std::get<0>(res).end());    
                 candidates += std::get<1>(res);
             }
         };
 
+        template<typename t_report>
+        struct visitor {
+            t_report& report;
+            uint64_t& candidates;
+            uint64_t query;
+            uint8_t radius;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                candidates += t.visit(query, radius, [&](uint64_t x, uint64_t) { report(TT::get_key(x)); return true; });
+            }
+        };
+
+        template<typename t_report>
+        struct unique_visitor {
+            t_report& report;
+            uint64_t& candidates;
+            uint64_t query;
+            uint8_t radius;
+            const splitter_cover<m_num_perms>& cover;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                candidates += t.visit(query, radius, [&](uint64_t x, uint64_t) {
+                    if ( cover.is_first(TT::id, TT::get_permuted_key(x)^permuted, 0, 0) ) {
+                        report(TT::get_key(x));
+                    }
+                    return true;
+                });
+            }
+        };
+
+        struct counter {
+            uint64_t& cnt;
+            uint64_t query;
+            uint8_t radius;
+            const splitter_cover<m_num_perms>& cover;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                t.visit(query, radius, [&](uint64_t x, uint64_t) {
+                    if ( cover.is_first(TT::id, TT::get_permuted_key(x)^permuted, 0, 0) ) ++cnt;
+                    return true;
+                });
+            }
+        };
+
+        struct mapped_checker {
+            bool& mapped;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                mapped = mapped and t.is_mapped();
+            }
+        };
+
+        struct existence_checker {
+            bool& found;
+            uint64_t query;
+            uint8_t radius;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                if ( found ) return;
+                t.visit(query, radius, [&](uint64_t, uint64_t) { found = true; return false; });
+            }
+        };
+
+        struct batch_matcher {
+            std::vector<batch_query>& batch;
+            result_sink& sink;
+            const uint64_t* queries;
+            size_t n;
+            uint8_t radius;
+            bool only_cands;
+            bool payloads;
+            batch_matcher(std::vector<batch_query>& b, result_sink& s, const uint64_t* qrys, size_t qn, uint8_t rad, bool only_cand, bool pay) :
+                batch(b), sink(s), queries(qrys), n(qn), radius(rad), only_cands(only_cand), payloads(pay)
+            { };
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                batch.clear();
+                for (size_t j = 0; j < n; ++j) {
+                    batch.push_back({queries[j], t.get_bucket_id(queries[j]), (uint32_t)j, radius});
+                }
+                std::sort(batch.begin(), batch.end());
+                t.match_batch(batch.data(), batch.data()+batch.size(), sink, only_cands, payloads);
+            }
+        };
+
 };
 
 }
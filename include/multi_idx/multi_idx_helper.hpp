@@ -1,23 +1,24 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+#include "multi_idx/key_source.hpp"
 #include "multi_idx/tuple_foreach.hpp"
+#include "multi_idx/mmap_io.hpp"
+#include "multi_idx/bucket_range.hpp"
 
 namespace multi_index {
 
-static std::unordered_map<std::string, uint64_t> stat_counter;
-//static std::map<uint64_t, uint64_t> bucket_distr;
-//static std::map<uint64_t, uint64_t> cluster_distr;
-
 template<typename t_index>
 std::map<uint64_t, uint64_t>
 get_bucket_dist(const t_index& index){
     std::map<uint64_t, uint64_t> res;
     uint64_t buckets = (typename decltype(index.m_C)::rank_1_type){&(index.m_C)}(index.m_C.size());
     for(uint64_t bucket=0; bucket<buckets; ++bucket){
-        const auto l = bucket == 0 ? 0 : index.m_C_sel(bucket) - bucket +1; 
-        const auto r = index.m_C_sel(bucket+1) - (bucket+1) + 1;  
-        ++res[r-l];            
+        const auto range = bucket_range(index.m_C, index.m_C_sel, bucket);
+        ++res[range.second-range.first];
     }
     return res;
 }
@@ -98,10 +99,22 @@ struct perm_type_gen<0, t_b, t_k, t_idx_strategy, t_perm>{
     using type = std::tuple<>;
 };
 
+//! Largest splitter_bits of the strategy classes of a tuple generated by perm_type_gen
+template<typename t_tuple, size_t t_i=std::tuple_size<t_tuple>::value>
+struct max_splitter_bits {
+    static constexpr uint8_t bits = std::tuple_element<t_i-1, t_tuple>::type::splitter_bits;
+    static constexpr uint8_t value = bits > max_splitter_bits<t_tuple, t_i-1>::value ? bits : max_splitter_bits<t_tuple, t_i-1>::value;
+};
+
+template<typename t_tuple>
+struct max_splitter_bits<t_tuple, 0> {
+    static constexpr uint8_t value = 0;
+};
+
 // Trait for the type of mid_entries for the split strategy classes
 template<uint8_t t_w>
     struct mid_entries_trait{
-    using type = sdsl::int_vector<>;
+    using type = mappable_int_vector<>;
     static type get_instance(typename type::size_type n, typename type::value_type x) {
         return type(n, x, t_w);
     } 
@@ -110,7 +123,7 @@ template<uint8_t t_w>
 
 template<>
     struct mid_entries_trait<16>{
-    using type = sdsl::int_vector<16>;
+    using type = mappable_int_vector<16>;
     static type get_instance(typename type::size_type n, typename type::value_type x) {
         return type(n, x);
     } 
@@ -119,7 +132,7 @@ template<>
 
 template<>
 struct mid_entries_trait<8>{
-    using type = sdsl::int_vector<8>;
+    using type = mappable_int_vector<8>;
     static type get_instance(typename type::size_type n, typename type::value_type x) {
         return type(n, x);
     } 
@@ -128,7 +141,7 @@ struct mid_entries_trait<8>{
 
 template<>
 struct mid_entries_trait<0>{
-    struct type : public sdsl::int_vector<>{
+    struct type : public mappable_int_vector<>{
         uint64_t operator[](uint64_t) const{
             return 0;
         }
@@ -140,11 +153,163 @@ struct mid_entries_trait<0>{
     static void assign(type&, uint64_t, uint64_t) { }
 };
 
+/*! Optional payloads (e.g. document ids) of the keys of a strategy class.
+ *  Entry i is the payload of the key at position i of the strategy's entry
+ *  arrays. The payloads are bit-compressed to the width of the largest one,
+ *  i.e. ceil(log2 n) bits for ids in [0,n), and are kept apart from the
+ *  scanned arrays, so they are only touched for matches.
+ */
+class payload_vector {
+    private:
+        mappable_int_vector<> m_payloads;
+
+    public:
+        typedef uint64_t size_type;
+
+        payload_vector() = default;
+
+        //! Reserves space for payloads in the order of the strategy; stays empty if payloads is empty
+        explicit payload_vector(const std::vector<uint64_t>& payloads) {
+            if ( payloads.empty() ) return;
+            const uint64_t max = *std::max_element(payloads.begin(), payloads.end());
+            m_payloads = mappable_int_vector<>(payloads.size(), 0, max == 0 ? 1 : sdsl::bits::hi(max)+1);
+        }
+
+        //! Reserves space for the payloads of a key source; stays empty without payloads
+        explicit payload_vector(const key_source& keys) {
+            if ( !keys.has_payloads() ) return;
+            const uint64_t max = keys.max_payload();
+            m_payloads = mappable_int_vector<>(keys.size(), 0, max == 0 ? 1 : sdsl::bits::hi(max)+1);
+        }
+
+        bool empty() const { return m_payloads.empty(); }
+        size_type size() const { return m_payloads.size(); }
+        uint8_t width() const { return m_payloads.width(); }
+
+        void set(size_type i, uint64_t x) { m_payloads[i] = x; }
+        uint64_t operator[](size_type i) const { return m_payloads[i]; }
+
+        /*! Assigns the payloads after the entries were reordered without
+         *  tracking their input positions (e.g. by std::sort or std::partition).
+         *  \param input_keys  Input keys; payloads[j] belongs to input_keys[j].
+         *  \param stored_keys The same keys in the order of the strategy, both
+         *                     under the same permutation.
+         *  \par Equal keys get their payloads in arbitrary order.
+         */
+        void assign_by_key(const std::vector<uint64_t>& input_keys, const std::vector<uint64_t>& payloads,
+                           const std::vector<uint64_t>& stored_keys) {
+            std::vector<std::pair<uint64_t,uint64_t>> in(input_keys.size()), st(stored_keys.size());
+            for (size_t j=0; j < in.size(); ++j) in[j] = {input_keys[j], payloads[j]};
+            for (size_t i=0; i < st.size(); ++i) st[i] = {stored_keys[i], i};
+            std::sort(in.begin(), in.end());
+            std::sort(st.begin(), st.end());
+            for (size_t i=0; i < st.size(); ++i) {
+                set(st[i].second, in[i].second);
+            }
+        }
+
+        size_type serialize(std::ostream& out, sdsl::structure_tree_node* v=nullptr, std::string name="") const {
+            using namespace sdsl;
+            structure_tree_node* child = structure_tree::add_child(v, name, util::class_name(*this));
+            size_type written_bytes = 0;
+            const uint64_t has_payloads = !empty();
+            written_bytes += write_member(has_payloads, out, child, "has_payloads");
+            if ( has_payloads ) {
+                written_bytes += m_payloads.serialize(out, child, "payloads");
+            }
+            structure_tree::add_size(child, written_bytes);
+            return written_bytes;
+        }
+
+        void load(std::istream& in) {
+            uint64_t has_payloads = 0;
+            sdsl::read_member(has_payloads, in);
+            m_payloads = mappable_int_vector<>();
+            if ( has_payloads ) {
+                m_payloads.load(in);
+            }
+        }
+};
+
+/*! Splitter bits of all permutations of an index in the permuted key space
+ *  of each permutation.
+ *
+ *  \par Let diff be the XOR of a key and the query, both permuted by
+ *       permutation i. Permutation j finds the key iff the splitter bits of j
+ *       in diff form one of its probed splitter masks, i.e. iff
+ *       popcount(diff & mask(i,j)) <= max_block_errors (0 for multi_idx,
+ *       radius/t_b for multi_idx_red). This allows counting each key under
+ *       a single permutation without reverse permuting it.
+ */
+template<size_t t_num_perms>
+class splitter_cover {
+    private:
+        typedef uint64_t (*perm_fun_t)(uint64_t);
+        std::array<std::array<uint64_t, t_num_perms>, t_num_perms> m_masks; // m_masks[i][j] = mask(i,j)
+
+        struct collector {
+            std::array<uint64_t, t_num_perms>& splitters; // splitter bits in the unpermuted key
+            std::array<perm_fun_t, t_num_perms>& permute;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t) const {
+                using TT = typename std::remove_reference<T>::type;
+                const uint64_t splitter = sdsl::bits::lo_set[TT::splitter_bits] << (64-TT::splitter_bits);
+                splitters[TT::id] = TT::perm::template rev_permute<TT::id>(splitter);
+                permute[TT::id] = &TT::perm::template permute<TT::id>;
+            }
+        };
+
+    public:
+        //! \param idx Tuple of strategy classes with ids 0..t_num_perms-1
+        template<typename t_tuple>
+        explicit splitter_cover(const t_tuple& idx) {
+            std::array<uint64_t, t_num_perms> splitters;
+            std::array<perm_fun_t, t_num_perms> permute;
+            collector c{splitters, permute};
+            tuple_foreach(idx, c);
+            for (size_t i=0; i < t_num_perms; ++i) {
+                for (size_t j=0; j < t_num_perms; ++j) {
+                    m_masks[i][j] = permute[i](splitters[j]);
+                }
+            }
+        }
+
+        /*! True if a key is counted under permutation i and splitter mask
+         *  block_mask: the key is found by this splitter mask and by no
+         *  permutation j < i.
+         *  \param diff Key XOR query, both permuted by permutation i.
+         */
+        bool is_first(size_t i, uint64_t diff, uint64_t block_mask, uint8_t max_block_errors) const {
+            if ( (diff & m_masks[i][i]) != block_mask ) return false;
+            for (size_t j=0; j < i; ++j) {
+                if ( sdsl::bits::cnt(diff & m_masks[i][j]) <= max_block_errors ) return false;
+            }
+            return true;
+        }
+
+        /*! True if permutation i is the first to find a key when the buckets
+         *  are probed level by level, i.e. with an increasing number e of
+         *  flipped splitter bits and for each e in order of the permutations
+         *  (see multi_idx_red::knn), and the key is found by block_mask.
+         *  \param diff Key XOR query, both permuted by permutation i.
+         */
+        bool is_first_level(size_t i, uint64_t diff, uint64_t block_mask) const {
+            if ( (diff & m_masks[i][i]) != block_mask ) return false;
+            const uint64_t e = sdsl::bits::cnt(block_mask);
+            for (size_t j=0; j < t_num_perms; ++j) {
+                const uint64_t e_j = sdsl::bits::cnt(diff & m_masks[i][j]);
+                if ( e_j < e or (e_j == e and j < i) ) return false;
+            }
+            return true;
+        }
+};
+
 template<typename t_strat, size_t t_id>
 void check_permutation(const std::vector<typename t_strat::entry_type> &input_entries) {
     std::cout << "Check permuting functions\n";
     for(auto x : input_entries) {
-        if (x != t_strat::perm_b_k::mi_rev_permute[t_id](t_strat::perm_b_k::mi_permute[t_id](x)))
+        if (x != t_strat::perm_b_k::template rev_permute<t_id>(t_strat::perm_b_k::template permute<t_id>(x)))
             std::cout << "ERROR permuting " << x << std::endl; 
     }
 }
@@ -1,10 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <string>
 #include <vector>
-#include <future>
 #include "sdsl/io.hpp"
 #include "multi_idx/perm.hpp"
+#include "multi_idx/key_source.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/thread_pool.hpp"
 #include "multi_idx/multi_idx.hpp"
 
 namespace multi_index {
@@ -22,6 +26,7 @@ class multi_idx_red {
     static_assert(t_k >= t_block_errors,"It should hold that t_k >= t_block_errors");
     public:    
         static constexpr uint8_t t_b = (t_k/(t_block_errors+1)) + 1;
+        static constexpr uint8_t k = t_k; // number of allowed errors
         typedef uint64_t  size_type;
         typedef perm<t_b,1> perm_b_k;
 
@@ -29,6 +34,8 @@ class multi_idx_red {
         static constexpr size_t m_num_perms = std::tuple_size<decltype(perm_b_k::mi_perms)>::value;
     public:
         typename perm_type_gen<m_num_perms, t_b, 1, t_idx_strategy, perm<t_b,1>>::type m_idx;
+    private:
+        std::vector<std::shared_ptr<mmap_file>> m_maps; // files of the permutations of a construction from a file
 
     public:
         multi_idx_red() = default;
@@ -41,19 +48,237 @@ class multi_idx_red {
         *  \param keys  Vector of hash values
         *  \pre Items are all different (no duplicates)
         */
-        multi_idx_red(const std::vector<uint64_t>& keys, bool async=false) {
-            constructor c{keys, async};
+        multi_idx_red(const std::vector<uint64_t>& keys, bool async=false) : multi_idx_red(keys, {}, async) {}
+
+        /*!
+        *  \param keys      Vector of hash values
+        *  \param payloads  payloads[i] is reported for a match of keys[i]
+        *                   by match_payloads, e.g. a document id.
+        *  \param async     Build with all hardware threads (see below).
+        *  \par Keys may occur several times with different payloads.
+        */
+        multi_idx_red(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& payloads, bool async=false) {
+            if ( async ) {
+                thread_pool pool;
+                build(key_source(keys, payloads), &pool);
+            } else {
+                build(key_source(keys, payloads), nullptr);
+            }
+        }
+
+        /*! Builds the index with the threads of pool.
+        *  \par The permutations are built concurrently and each strategy
+        *       sorts its entries into buckets and clusters them in parallel.
+        *       The result is identical to a serial construction.
+        */
+        multi_idx_red(const std::vector<uint64_t>& keys, const std::vector<uint64_t>& payloads, thread_pool& pool) {
+            build(key_source(keys, payloads), &pool);
+        }
+
+        /*! Builds the index from keys in memory or in a file (see key_source).
+        *  \par Keys in a file are streamed into the arrays of one permutation
+        *       after another with the scratch memory of the budget of the
+        *       source (see bucket_scatter). Each permutation is then written
+        *       to a temporary file next to the key file and mapped back, so
+        *       only the arrays of one permutation are in memory at a time.
+        *       The triangle cluster and adaptive strategies additionally
+        *       keep the permuted keys of one permutation in memory while they
+        *       cluster. Duplicates in the file are kept as separate entries.
+        */
+        explicit multi_idx_red(const key_source& keys) {
+            build(keys, nullptr);
+        }
+
+        //! Builds the index from keys in memory or in a file with the threads of pool
+        multi_idx_red(const key_source& keys, thread_pool& pool) {
+            build(keys, &pool);
+        }
+
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) const {
+            return match(query, t_k, find_only_candidates);
+        }
+
+        /*! Returns all keys within distance radius of query.
+         *  \param radius Search radius in [0, t_k]; larger values are clamped to t_k.
+         *  \par radius is an int, so that match(q, 2) does not convert 2 to
+         *       find_only_candidates. Only the splitter masks with at most
+         *       floor(radius/t_b) bits are probed, since a key within distance
+         *       radius has a block with at most that many errors. So one
+         *       index built for t_k matches smaller radii at the speed of an
+         *       index built for them.
+         */
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const int radius, const bool find_only_candidates=false) const {
+            std::vector<uint64_t> matches;
+            uint64_t candidates = 0;
+            if ( find_only_candidates ) {
+                matcher m{matches, candidates, query, clamp_radius(radius), true, false};
+                tuple_foreach(m_idx, m);
+            } else {
+                candidates = match(query, matches, radius);
+            }
+            return {matches, candidates};
+        }
+
+        /*! Appends the keys within distance radius of query to out and returns
+         *  the number of candidates. The results are the same as for match.
+         *  \par Apart from the growth of out nothing is allocated, so a buffer
+         *       which is cleared and reused between queries avoids all heap
+         *       allocations of the query path.
+         */
+        uint64_t match(const uint64_t query, std::vector<uint64_t>& out, const int radius=t_k) const {
+            return visit(query, [&](uint64_t key) { out.push_back(key); }, radius);
+        }
+
+        /*! Calls report(key) for each key within distance radius of query,
+         *  in the same order and with the same duplicates as match.
+         *  \return The number of candidates.
+         */
+        template<typename t_report>
+        uint64_t visit(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            uint64_t candidates = 0;
+            visitor<t_report> v{report, candidates, query, clamp_radius(radius)};
+            tuple_foreach(m_idx, v);
+            return candidates;
+        }
+
+        /*! Like match, but reports each key within distance radius exactly once.
+         *  \par A match is only kept under the first permutation which finds
+         *       it (see splitter_cover), so no sort/unique pass over the result
+         *       is needed.
+         */
+        std::pair<std::vector<uint64_t>,uint64_t> match_unique(const uint64_t query, const int radius=t_k) const {
+            std::vector<uint64_t> matches;
+            const uint64_t candidates = visit_unique(query, [&](uint64_t key) { matches.push_back(key); }, radius);
+            return {matches, candidates};
+        }
+
+        /*! Calls report(key) for each key within distance radius of query
+         *  exactly once, in the same order as match_unique.
+         *  \return The number of candidates.
+         */
+        template<typename t_report>
+        uint64_t visit_unique(const uint64_t query, t_report&& report, const int radius=t_k) const {
+            uint64_t candidates = 0;
+            unique_visitor<t_report> v{report, candidates, query, clamp_radius(radius), cover()};
+            tuple_foreach(m_idx, v);
+            return candidates;
+        }
+
+        /*! Number of distinct keys within distance radius of query.
+         *  \par No result vector is built and no key is reverse permuted. A
+         *       key is only counted under the first permutation which finds
+         *       it (see splitter_cover).
+         */
+        uint64_t count(const uint64_t query, const int radius=t_k) const {
+            uint64_t cnt = 0;
+            counter c{cnt, query, clamp_radius(radius), cover()};
             tuple_foreach(m_idx, c);
+            return cnt;
         }
 
-        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, const bool find_only_candidates=false) {
+        //! True if a key within distance radius of query exists; stops at the first verified match
+        bool exists(const uint64_t query, const int radius=t_k) const {
+            bool found = false;
+            existence_checker e{found, query, clamp_radius(radius)};
+            tuple_foreach(m_idx, e);
+            return found;
+        }
+
+        //! Like match, but returns the payloads of the matching keys instead of the keys
+        std::pair<std::vector<uint64_t>,uint64_t> match_payloads(const uint64_t query, const bool find_only_candidates=false) const {
+            return match_payloads(query, t_k, find_only_candidates);
+        }
+
+        std::pair<std::vector<uint64_t>,uint64_t> match_payloads(const uint64_t query, const int radius, const bool find_only_candidates=false) const {
             std::vector<uint64_t> matches;
             uint64_t candidates = 0;
-            matcher m{matches, candidates, query, find_only_candidates};
+            matcher m{matches, candidates, query, clamp_radius(radius), find_only_candidates, true};
             tuple_foreach(m_idx, m);
             return {matches, candidates};
         }
 
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, thread_pool& pool, const bool find_only_candidates=false) const {
+            return match(query, pool, t_k, find_only_candidates);
+        }
+
+        /*! Matches query and runs the sub-queries (permutation x splitter mask)
+         *  in parallel on pool. The matches of the chunks of sub-queries are
+         *  concatenated in chunk order, so they are the same as for
+         *  match(query, radius) up to order.
+         *  \par Each chunk has its own result buffer, so several request
+         *       threads may share one pool.
+         */
+        std::pair<std::vector<uint64_t>,uint64_t> match(const uint64_t query, thread_pool& pool, const int radius, const bool find_only_candidates=false) const {
+            return parallel_match(query, pool, clamp_radius(radius), find_only_candidates, false);
+        }
+
+        //! Like match(query, pool, radius), but returns the payloads of the matching keys instead of the keys
+        std::pair<std::vector<uint64_t>,uint64_t> match_payloads(const uint64_t query, thread_pool& pool, const int radius=t_k, const bool find_only_candidates=false) const {
+            return parallel_match(query, pool, clamp_radius(radius), find_only_candidates, true);
+        }
+
+        /*! Returns the (at most) k keys closest to query in Hamming distance
+         *  as (distance, key) pairs in increasing order; ties are broken by key.
+         *
+         *  \par The buckets are probed with an increasing number e of flipped
+         *       splitter bits, i.e. first with the masks of splitter_mask and
+         *       then with masks enumerated on the fly. A key with distance d
+         *       has a block with at most floor(d/t_b) errors. After level e
+         *       all keys with distance < (e+1)*t_b were seen, so the search
+         *       stops as soon as the k-th best distance is below this bound.
+         *       Only bucket entries which can enter the bounded heap of the k
+         *       best keys are reported by the strategy classes. A key is only
+         *       taken at the first level and permutation which finds it (see
+         *       splitter_cover::is_first_level), so keys stored several times
+         *       are returned several times.
+         *  \par If a level has more splitter masks than the index has keys,
+         *       the search falls back to a linear scan of the first permutation.
+         */
+        std::vector<std::pair<uint8_t,uint64_t>> knn(const uint64_t query, const size_t k) const {
+            if ( k == 0 ) return {};
+            knn_heap heap{k, {}};
+            bool exhausted = false;
+            for (uint8_t e = 0; !exhausted; ++e) {
+                uint64_t probes = 0;
+                knn_probe_counter c{probes, e};
+                tuple_foreach(m_idx, c);
+                if ( probes > size() ) {
+                    heap.entries.clear();
+                    const auto& t = std::get<0>(m_idx);
+                    t.visit_all([&](uint64_t x, uint64_t) {
+                        const uint64_t key = t.get_key(x);
+                        heap.push(sdsl::bits::cnt(key^query), key);
+                        return true;
+                    });
+                    break;
+                }
+                knn_prober p{heap, query, e, exhausted, cover()};
+                tuple_foreach(m_idx, p);
+                if ( heap.full() and heap.worst().first < (e+1)*t_b ) break;
+            }
+            std::sort(heap.entries.begin(), heap.entries.end());
+            return heap.entries;
+        }
+
+        /*! Matches a batch of queries.
+         *  \param queries Pointer to the first query key.
+         *  \param n       Number of queries.
+         *  \param sink    Receives the matches and candidates of query i under id i.
+         *  \param report_payloads Store the payloads of the matches instead of the keys.
+         *  \param radius  Search radius in [0, t_k] for all queries of the batch.
+         *
+         *  \par For each permutation the (sub-)queries of the batch are sorted
+         *       by bucket, so that each bucket range is located once and
+         *       scanned consecutively for all queries which hit it.
+         */
+        void match_batch(const uint64_t* queries, size_t n, result_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false, const int radius=t_k) const {
+            sink.reset(n);
+            std::vector<batch_query> batch;
+            batch_matcher m{batch, sink, queries, n, clamp_radius(radius), find_only_candidates, report_payloads};
+            tuple_foreach(m_idx, m);
+            sink.finalize();
+        }
+
         //! Serializes the data structure into the given ostream
         uint64_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr,
                           std::string name = "") const {
@@ -71,6 +296,7 @@ class multi_idx_red {
         void load(std::istream &in) {
             loader l{in};
             tuple_foreach(m_idx, l);
+            m_maps.clear();
         }
 
         uint64_t size() const {
@@ -80,30 +306,113 @@ class multi_idx_red {
             return 0;
         }
 
+        //! True if the packed arrays of all permutations live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            bool mapped = true;
+            mapped_checker c{mapped};
+            tuple_foreach(m_idx, c);
+            return mapped;
+        }
+
     private:
+        static uint8_t clamp_radius(const int radius) {
+            return (uint8_t)std::max(0, std::min((int)t_k, radius));
+        }
+
+        std::pair<std::vector<uint64_t>,uint64_t> parallel_match(const uint64_t query, thread_pool& pool, const uint8_t radius, const bool only_cands, const bool payloads) const {
+            std::array<size_t, m_num_perms+1> offsets;
+            offsets[0] = 0;
+            sub_query_counter c{offsets, radius};
+            tuple_foreach(m_idx, c);
+            const size_t total = offsets[m_num_perms];
+
+            const size_t grain = std::max((size_t)1, total/(4*pool.size()));
+            const size_t chunks = (total+grain-1)/grain;
+            std::vector<std::vector<uint64_t>> chunk_matches(chunks);
+            std::vector<uint64_t> chunk_candidates(chunks, 0);
+            pool.parallel_for(total, grain, [&](size_t begin, size_t end, size_t){
+                const size_t chunk = begin/grain;
+                range_matcher m{chunk_matches[chunk], chunk_candidates[chunk], query, radius, only_cands, payloads, offsets, begin, end};
+                tuple_foreach(m_idx, m);
+            });
+
+            std::vector<uint64_t> matches;
+            uint64_t candidates = 0;
+            for (size_t i=0; i < chunks; ++i) {
+                matches.insert(matches.end(), chunk_matches[i].begin(), chunk_matches[i].end());
+                candidates += chunk_candidates[i];
+            }
+            return {matches, candidates};
+        }
+
+        // Number of splitter masks which have to be probed for radius. A key
+        // within distance radius has a block with at most radius/t_b errors
+        // and the precomputed masks are sorted by their number of set bits.
+        template<uint8_t t_splitter_bits>
+        static size_t num_splitter_masks(const uint8_t radius) {
+            return splitter_mask<t_splitter_bits, t_block_errors>::all_binomial(t_splitter_bits, radius/t_b);
+        }
+
+        const splitter_cover<m_num_perms>& cover() const {
+            static const splitter_cover<m_num_perms> c(m_idx);
+            return c;
+        }
+
         // Functors which do the actual work on the tuple of indexes
 
         struct constructor {
-            const std::vector<uint64_t>& items;
-            bool is_async;
-            std::vector<std::future<int>> futures;
+            const key_source& items;
+            thread_pool* pool;
+            size_t perm; // id of the permutation to build
 
-            constructor(const std::vector<uint64_t>& f_items, bool asy=false):items(f_items),is_async(asy) {};
+            template <typename T>
+            void operator()(T&& t, std::size_t i) const {
+                if ( i == perm ) {
+                    t = (typename std::remove_reference<T>::type){items, pool};
+                }
+            }
+        };
+
+        struct spiller {
+            std::vector<std::shared_ptr<mmap_file>>& maps;
+            const std::string& prefix;
+            size_t perm; // id of the permutation to spill
 
             template <typename T>
-            void operator()(T&& t, std::size_t i) {
-                if ( is_async ) {
-                    std::cout<<"start construction thread"<<std::endl;
-                    futures.push_back( std::async(std::launch::async,[&](){ 
-                        t = (typename std::remove_reference<T>::type){items}; 
-                        return 1;
-                    }));
-                } else { 
-                    t = (typename std::remove_reference<T>::type){items}; 
+            void operator()(T&& t, std::size_t i) const {
+                if ( i == perm ) {
+                    auto map = spill_to_mapped_file(t, prefix + std::to_string(i));
+                    if ( map ) maps.push_back(map);
                 }
             }
         };
 
+        void build(const key_source& keys, thread_pool* pool) {
+            m_maps.clear();
+            if ( !keys.in_memory() ) {
+                // one permutation at a time; the pool works within a permutation
+                const std::string prefix = keys.temp_prefix();
+                for (size_t i=0; i < m_num_perms; ++i) {
+                    constructor c{keys, pool, i};
+                    tuple_foreach(m_idx, c);
+                    spiller s{m_maps, prefix, i};
+                    tuple_foreach(m_idx, s);
+                }
+                return;
+            }
+            auto build_perms = [&](size_t begin, size_t end, size_t) {
+                for (size_t i=begin; i < end; ++i) {
+                    constructor c{keys, pool, i};
+                    tuple_foreach(m_idx, c);
+                }
+            };
+            if ( pool != nullptr ) {
+                pool->parallel_for(m_num_perms, 1, build_perms);
+            } else {
+                build_perms(0, m_num_perms, 0);
+            }
+        }
+
         struct serializer {
             uint64_t& wb;
             sdsl::structure_tree_node *c;
@@ -129,28 +438,295 @@ class multi_idx_red {
             std::vector<uint64_t>& matches;
             uint64_t& candidates;
             uint64_t query;
+            uint8_t radius;
             bool only_cands;
-            matcher(std::vector<uint64_t>& mats, uint64_t& cands, uint64_t qry, bool only_cand) : 
-                matches(mats), candidates(cands), query(qry), only_cands(only_cand)
+            bool payloads;
+            matcher(std::vector<uint64_t>& mats, uint64_t& cands, uint64_t qry, uint8_t rad, bool only_cand, bool pay) : 
+                matches(mats), candidates(cands), query(qry), radius(rad), only_cands(only_cand), payloads(pay)
             { };
 
             template<typename T>
             void operator()(T&& t, std::size_t i) const {
                 using TT = typename std::remove_reference<T>::type;
-                  // For all block_errors <= t_block_errors match
-                  // with flipping block_errors bits for t_k errors
-                  for (auto block_mask : splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data) {
-                        uint64_t query_flipped = TT::perm::mi_permute[TT::id](query);
+                  // For all block_errors <= radius/t_b match
+                  // with flipping block_errors bits for radius errors
+                  const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                  const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                  for (size_t j = 0; j < num_masks; ++j) {
+                        const uint64_t block_mask = masks[j];
+                        uint64_t query_flipped = TT::perm::template permute<TT::id>(query);
                         query_flipped = query_flipped ^ block_mask;
-                        query_flipped = TT::perm::mi_rev_permute[TT::id](query_flipped);
+                        query_flipped = TT::perm::template rev_permute<TT::id>(query_flipped);
                         uint32_t block_errors = sdsl::bits::cnt(block_mask);
-                        auto res = t.match(query_flipped, t_k-block_errors, only_cands);
+                        auto res = t.match(query_flipped, radius-block_errors, only_cands, payloads);
                         matches.insert(matches.end(), std::get<0>(res).begin(), std::get<0>(res).end());    
                         candidates += std::get<1>(res);
                   }
             }
         };
 
+        // Calculates the start of the sub-queries of each permutation in the flat sub-query order
+        struct sub_query_counter {
+            std::array<size_t, m_num_perms+1>& offsets;
+            uint8_t radius;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                offsets[i+1] = offsets[i] + num_splitter_masks<TT::splitter_bits>(radius);
+            }
+        };
+
+        // Matches the sub-queries in [begin, end) of the flat sub-query order like
+        // visitor, or like matcher for candidates and payloads
+        struct range_matcher {
+            std::vector<uint64_t>& matches;
+            uint64_t& candidates;
+            uint64_t query;
+            uint8_t radius;
+            bool only_cands;
+            bool payloads;
+            const std::array<size_t, m_num_perms+1>& offsets;
+            size_t begin;
+            size_t end;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const size_t lb = std::max(begin, offsets[i]);
+                const size_t rb = std::min(end, offsets[i+1]);
+                if ( lb >= rb ) return;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                if ( !only_cands and !payloads ) {
+                    candidates += t.visit_masks(permuted, masks.data() + (lb-offsets[i]), rb-lb, radius, [&](uint64_t x, uint64_t, size_t) {
+                        matches.push_back(TT::get_key(x));
+                        return true;
+                    });
+                    return;
+                }
+                for (size_t j = lb; j < rb; ++j) {
+                    const uint64_t block_mask = masks[j-offsets[i]];
+                    uint64_t query_flipped = TT::perm::template rev_permute<TT::id>(permuted ^ block_mask);
+                    auto res = t.match(query_flipped, radius - sdsl::bits::cnt(block_mask), only_cands, payloads);
+                    matches.insert(matches.end(), std::get<0>(res).begin(), std::get<0>(res).end());
+                    candidates += std::get<1>(res);
+                }
+            }
+        };
+
+        // Bounded max-heap of the best (distance, key) pairs found so far
+        struct knn_heap {
+            size_t k;
+            std::vector<std::pair<uint8_t,uint64_t>> entries;
+
+            bool full() const {
+                return entries.size() >= k;
+            }
+
+            const std::pair<uint8_t,uint64_t>& worst() const {
+                return entries.front();
+            }
+
+            // Largest distance a key can have to enter the heap
+            uint8_t bound() const {
+                return full() ? worst().first : 64;
+            }
+
+            void push(uint8_t dist, uint64_t key) {
+                const std::pair<uint8_t,uint64_t> x{dist, key};
+                if ( full() and !(x < worst()) ) return;
+                if ( full() ) {
+                    std::pop_heap(entries.begin(), entries.end());
+                    entries.pop_back();
+                }
+                entries.push_back(x);
+                std::push_heap(entries.begin(), entries.end());
+            }
+        };
+
+        // Number of buckets which knn probes at level e
+        struct knn_probe_counter {
+            uint64_t& probes;
+            uint8_t e;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                if ( e <= TT::splitter_bits ) probes += splitter_mask<TT::splitter_bits, t_block_errors>::binomial(TT::splitter_bits, e);
+            }
+        };
+
+        // Probes all buckets whose splitter differs from the query in exactly e bits
+        struct knn_prober {
+            knn_heap& heap;
+            uint64_t query;
+            uint8_t e;
+            bool& exhausted;
+            const splitter_cover<m_num_perms>& cover;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                constexpr uint8_t bits = TT::splitter_bits;
+                if ( e > bits ) return;
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                auto probe = [&](uint64_t block_mask) {
+                    // All keys in the bucket differ from query in the e flipped bits
+                    if ( heap.bound() < e ) return;
+                    uint64_t query_flipped = TT::perm::template rev_permute<TT::id>(permuted ^ block_mask);
+                    t.visit(query_flipped, heap.bound() - e, [&](uint64_t x, uint64_t) {
+                        // A key is found once for each permutation in which it is probed
+                        if ( cover.is_first_level(TT::id, TT::get_permuted_key(x)^permuted, block_mask) ) {
+                            const uint64_t key = TT::get_key(x);
+                            heap.push(sdsl::bits::cnt(key^query), key);
+                        }
+                        return true;
+                    });
+                };
+                const auto& masks = splitter_mask<bits, t_block_errors>::precomp.data;
+                if ( e <= t_block_errors ) {
+                    // The precomputed masks are sorted by the number of set bits
+                    for (auto block_mask : masks) {
+                        if ( sdsl::bits::cnt(block_mask) == e ) probe(block_mask);
+                    }
+                } else {
+                    // Enumerate the bits-bit words with e set bits in lexicographic order
+                    uint64_t x = sdsl::bits::lo_set[e];
+                    while ( x < (1ULL << bits) ) {
+                        probe(x << (64-bits));
+                        const uint64_t c = x & -x;
+                        const uint64_t r = x + c;
+                        x = (((r^x) >> 2) / c) | r;
+                    }
+                }
+                if ( e == bits ) {
+                    exhausted = true; // all buckets of this permutation were probed
+                }
+            }
+        };
+
+        template<typename t_report>
+        struct visitor {
+            t_report& report;
+            uint64_t& candidates;
+            uint64_t query;
+            uint8_t radius;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                candidates += t.visit_masks(permuted, masks.data(), num_masks, radius, [&](uint64_t x, uint64_t, size_t) {
+                    report(TT::get_key(x));
+                    return true;
+                });
+            }
+        };
+
+        template<typename t_report>
+        struct unique_visitor {
+            t_report& report;
+            uint64_t& candidates;
+            uint64_t query;
+            uint8_t radius;
+            const splitter_cover<m_num_perms>& cover;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                candidates += t.visit_masks(permuted, masks.data(), num_masks, radius, [&](uint64_t x, uint64_t, size_t j) {
+                    if ( cover.is_first(TT::id, TT::get_permuted_key(x)^permuted, masks[j], radius/t_b) ) {
+                        report(TT::get_key(x));
+                    }
+                    return true;
+                });
+            }
+        };
+
+        struct counter {
+            uint64_t& cnt;
+            uint64_t query;
+            uint8_t radius;
+            const splitter_cover<m_num_perms>& cover;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                t.visit_masks(permuted, masks.data(), num_masks, radius, [&](uint64_t x, uint64_t, size_t j) {
+                    if ( cover.is_first(TT::id, TT::get_permuted_key(x)^permuted, masks[j], radius/t_b) ) ++cnt;
+                    return true;
+                });
+            }
+        };
+
+        struct mapped_checker {
+            bool& mapped;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                mapped = mapped and t.is_mapped();
+            }
+        };
+
+        struct existence_checker {
+            bool& found;
+            uint64_t query;
+            uint8_t radius;
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                if ( found ) return;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                const uint64_t permuted = TT::perm::template permute<TT::id>(query);
+                t.visit_masks(permuted, masks.data(), num_masks, radius, [&](uint64_t, uint64_t, size_t) { found = true; return false; });
+            }
+        };
+
+        struct batch_matcher {
+            std::vector<batch_query>& batch;
+            result_sink& sink;
+            const uint64_t* queries;
+            size_t n;
+            uint8_t radius;
+            bool only_cands;
+            bool payloads;
+            batch_matcher(std::vector<batch_query>& b, result_sink& s, const uint64_t* qrys, size_t qn, uint8_t rad, bool only_cand, bool pay) :
+                batch(b), sink(s), queries(qrys), n(qn), radius(rad), only_cands(only_cand), payloads(pay)
+            { };
+
+            template<typename T>
+            void operator()(T&& t, std::size_t i) const {
+                using TT = typename std::remove_reference<T>::type;
+                const auto& masks = splitter_mask<TT::splitter_bits, t_block_errors>::precomp.data;
+                const size_t num_masks = num_splitter_masks<TT::splitter_bits>(radius);
+                batch.clear();
+                batch.reserve(n * num_masks);
+                // Each query contributes one sub-query per splitter mask
+                for (size_t j = 0; j < n; ++j) {
+                    const uint64_t permuted = TT::perm::template permute<TT::id>(queries[j]);
+                    for (size_t m = 0; m < num_masks; ++m) {
+                        const uint64_t block_mask = masks[m];
+                        uint64_t query_flipped = TT::perm::template rev_permute<TT::id>(permuted ^ block_mask);
+                        uint8_t errors = radius - sdsl::bits::cnt(block_mask);
+                        batch.push_back({query_flipped, t.get_bucket_id(query_flipped), (uint32_t)j, errors});
+                    }
+                }
+                std::sort(batch.begin(), batch.end());
+                t.match_batch(batch.data(), batch.data()+batch.size(), sink, only_cands, payloads);
+            }
+        };
+
 };
 
 }
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+#include "sdsl/bit_vectors.hpp"
+#include "multi_idx/aux_bits.hpp"
+
+template<uint8_t t_splitter_bits, uint8_t t_block_errors>
+struct splitter_mask{
+    static constexpr size_t binomial(size_t n, size_t k){
+        if ( n < k )
+            return 0;
+        if ( k == 0 or n == k )
+            return 1;
+        if ( k == 1 )
+            return n;
+        return (n*binomial(n-1, k-1))/k;
+    }
+
+    static constexpr size_t all_binomial(size_t n, size_t k) {
+        return k==0 ? 1 : binomial(n, k) + all_binomial(n, k-1);
+    }
+
+    static struct impl {
+        std::array<uint64_t, all_binomial(t_splitter_bits, t_block_errors)> data;
+
+        impl(){
+            size_t idx=0;
+            data[idx++] = 0ULL;
+            for (size_t block_errors=1; block_errors <= t_block_errors; ++block_errors) {
+                sdsl::bit_vector mask(t_splitter_bits, 0);
+                for(size_t i=0; i<block_errors; ++i) mask[mask.size()-i-1] = 1;
+                do {
+                    data[idx++] = (mask.get_int(0, mask.size())) << (64-mask.size());
+                } while ( next_permutation( mask.begin(), mask.end() ) );
+            }
+        }
+    } precomp;
+};
+
+template<uint8_t t_splitter_bits, uint8_t t_block_errors>
+typename splitter_mask<t_splitter_bits, t_block_errors>::impl splitter_mask<t_splitter_bits,t_block_errors>::precomp;
+
+namespace perm_detail {
+
+constexpr size_t binomial(size_t n, size_t k) {
+    return k > n ? 0 : (k == 0 ? 1 : n*binomial(n-1, k-1)/k);
+}
+
+constexpr uint64_t block_mask(uint8_t width, uint8_t offset) {
+    return (width == 64 ? ~0ULL : ((1ULL << width)-1)) << offset;
+}
+
+/*! Permutations of perm<t_b, t_k> and the instructions to apply them,
+ *  computed at compile time.
+ *
+ *  \par The 64 bits are split into t_b blocks; the last 64 % t_b blocks are
+ *       one bit wider than the others. The permutations are the binomial(t_b,
+ *       t_k) ones of Knuth, TAoCP Vol. 3, Exercise 6.5-1: for each t_k-subset
+ *       of the blocks there is a permutation that places the subset next to
+ *       each other. perms[p][j] is the block at position j of permutation p,
+ *       where position 0 holds the least significant bits.
+ *
+ *  \par A permutation moves each block by a rotation. Blocks moved by the
+ *       same rotation form one group, so a permutation takes one AND and one
+ *       rotation per group. With BMI2 the blocks can instead be split into
+ *       groups which keep their relative order; each such group takes one
+ *       PEXT and one PDEP. The BMI2 variant is only used when it needs fewer
+ *       groups.
+ */
+template<uint8_t t_b, uint8_t t_k>
+struct perm_table {
+    static constexpr size_t num_perms = binomial(t_b, t_k);
+
+    uint8_t  sizes[t_b] = {};                   // width of block i of the key
+    uint8_t  perms[num_perms][t_b] = {};
+    uint8_t  widths[num_perms][t_b] = {};       // width of the block at position j
+    uint8_t  widths_sums[num_perms][t_b] = {};  // offset of the block at position j
+    uint64_t rot_mask[num_perms][t_b] = {};     // group g: rotate the bits rot_mask by rot
+    uint8_t  rot[num_perms][t_b] = {};
+    uint8_t  rot_groups[num_perms] = {};
+    uint64_t ext_mask[num_perms][t_b] = {};     // group g: move the bits ext_mask to dep_mask
+    uint64_t dep_mask[num_perms][t_b] = {};
+    uint8_t  ext_groups[num_perms] = {};
+
+    constexpr perm_table() {
+        uint8_t offsets[t_b+1] = {};
+        for (size_t i=0; i < t_b; ++i) {
+            sizes[i] = 64/t_b + (i >= t_b - 64%t_b);
+            offsets[i+1] = offsets[i] + sizes[i];
+        }
+        uint8_t subset[t_k+1] = {};
+        for (size_t j=0; j < t_k; ++j) subset[j] = j;
+        for (size_t p=0; p < num_perms; ++p) {
+            // Exercise 6.5-1: blocks of the subset which are not matched by
+            // an earlier one go to the front (A), the matched ones to the end
+            // (C) and the remaining blocks in between (B).
+            uint8_t a[t_b] = {}, b[t_b] = {}, c[t_b] = {};
+            size_t na = 0, nb = 0, nc = 0, j = 0;
+            int up = 0, min = 0;
+            for (uint8_t i=0; i < t_b; ++i) {
+                if ( j >= t_k or i != subset[j] ) {
+                    b[nb++] = i;
+                    ++up;
+                } else {
+                    --up;
+                    ++j;
+                    if ( up < min ) {
+                        min = up;
+                        b[nb++] = i;
+                    } else {
+                        a[na++] = i;
+                        c[nc++] = b[--nb];
+                    }
+                }
+            }
+            size_t pos = 0;
+            for (size_t i=0; i < na; ++i) perms[p][pos++] = a[i];
+            for (size_t i=0; i < nb; ++i) perms[p][pos++] = b[i];
+            for (size_t i=0; i < nc; ++i) perms[p][pos++] = c[i];
+
+            uint8_t target[t_b] = {};   // position of block i
+            uint8_t last[t_b] = {};     // last position in ext group g
+            uint8_t sum = 0;
+            for (size_t i=0; i < t_b; ++i) {
+                const uint8_t blk = perms[p][i];
+                widths[p][i] = sizes[blk];
+                widths_sums[p][i] = sum;
+                target[blk] = i;
+                const uint8_t r = (sum - offsets[blk]) & 63;
+                size_t g = 0;
+                while ( g < rot_groups[p] and rot[p][g] != r ) ++g;
+                if ( g == rot_groups[p] ) {
+                    rot[p][g] = r;
+                    ++rot_groups[p];
+                }
+                rot_mask[p][g] |= block_mask(sizes[blk], offsets[blk]);
+                sum += sizes[blk];
+            }
+            for (size_t blk=0; blk < t_b; ++blk) {
+                size_t g = 0;
+                while ( g < ext_groups[p] and last[g] > target[blk] ) ++g;
+                if ( g == ext_groups[p] ) ++ext_groups[p];
+                last[g] = target[blk];
+                ext_mask[p][g] |= block_mask(sizes[blk], offsets[blk]);
+                dep_mask[p][g] |= block_mask(sizes[blk], widths_sums[p][target[blk]]);
+            }
+
+            // next t_k-subset in lexicographic order
+            size_t i = t_k;
+            while ( i > 0 and subset[i-1] == t_b-t_k+i-1 ) --i;
+            if ( i > 0 ) {
+                ++subset[i-1];
+                for (; i < t_k; ++i) subset[i] = subset[i-1]+1;
+            }
+        }
+    }
+};
+
+template<typename T, size_t N, size_t... t_i>
+constexpr std::array<T,N> to_array(const T (&a)[N], std::index_sequence<t_i...>) {
+    return {{a[t_i]...}};
+}
+
+template<typename T, size_t M, size_t N, size_t... t_i>
+constexpr std::array<std::array<T,N>,M> to_array(const T (&a)[M][N], std::index_sequence<t_i...>) {
+    return {{to_array(a[t_i], std::make_index_sequence<N>{})...}};
+}
+
+}
+
+/*! Block permutations for a multi-index with t_b blocks where t_k blocks
+ *  have to match exactly. Everything is computed at compile time, so any
+ *  combination of t_b and t_k is available without generated code.
+ *
+ *  \par The permutation id is a template parameter of permute and
+ *       rev_permute, so that calls are inlined at the call site and compile
+ *       to a few instructions with constant masks.
+ */
+template<uint8_t t_b, uint8_t t_k>
+struct perm{
+    static_assert(t_b > 0 and t_b <= 64 and t_k > 0 and t_k <= t_b, "perm requires 0 < t_k <= t_b <= 64");
+
+    typedef perm_detail::perm_table<t_b,t_k> table_type;
+    static constexpr table_type table{};
+    static constexpr size_t num_perms = table_type::num_perms;
+
+    static constexpr uint8_t max_dist = t_b-t_k;
+    static constexpr uint8_t match_len = t_k;
+
+    //! Applies permutation t_id to x
+    template<size_t t_id>
+    static inline uint64_t permute(uint64_t x) {
+#ifdef __BMI2__
+        if ( table.ext_groups[t_id] < table.rot_groups[t_id] ) {
+            uint64_t y = 0;
+            for (size_t g=0; g < table.ext_groups[t_id]; ++g) {
+                y |= _pdep_u64(_pext_u64(x, table.ext_mask[t_id][g]), table.dep_mask[t_id][g]);
+            }
+            return y;
+        }
+#endif
+        uint64_t y = 0;
+        for (size_t g=0; g < table.rot_groups[t_id]; ++g) {
+            y |= rol(x & table.rot_mask[t_id][g], table.rot[t_id][g]);
+        }
+        return y;
+    }
+
+    //! Inverse of permute<t_id>
+    template<size_t t_id>
+    static inline uint64_t rev_permute(uint64_t x) {
+#ifdef __BMI2__
+        if ( table.ext_groups[t_id] < table.rot_groups[t_id] ) {
+            uint64_t y = 0;
+            for (size_t g=0; g < table.ext_groups[t_id]; ++g) {
+                y |= _pdep_u64(_pext_u64(x, table.dep_mask[t_id][g]), table.ext_mask[t_id][g]);
+            }
+            return y;
+        }
+#endif
+        uint64_t y = 0;
+        for (size_t g=0; g < table.rot_groups[t_id]; ++g) {
+            y |= rol(x & rol(table.rot_mask[t_id][g], table.rot[t_id][g]), -table.rot[t_id][g]);
+        }
+        return y;
+    }
+
+    static constexpr std::array<std::array<uint8_t,t_b>,num_perms> mi_perms =
+        perm_detail::to_array(table.perms, std::make_index_sequence<num_perms>{});
+    static constexpr std::array<uint8_t,t_b> mi_permute_block_sizes =
+        perm_detail::to_array(table.sizes, std::make_index_sequence<t_b>{});
+    // width of the blocks in the 64-bit word
+    static constexpr std::array<std::array<uint8_t,t_b>,num_perms> mi_permute_block_widths =
+        perm_detail::to_array(table.widths, std::make_index_sequence<num_perms>{});
+    // prefix sums of widths of the blocks in the 64-bit word
+    static constexpr std::array<std::array<uint8_t,t_b>,num_perms> mi_permute_block_widths_sums =
+        perm_detail::to_array(table.widths_sums, std::make_index_sequence<num_perms>{});
+};
+
+template<uint8_t t_b, uint8_t t_k>
+constexpr typename perm<t_b,t_k>::table_type perm<t_b,t_k>::table;
+
+template<uint8_t t_b, uint8_t t_k>
+constexpr std::array<std::array<uint8_t,t_b>,perm<t_b,t_k>::num_perms> perm<t_b,t_k>::mi_perms;
+
+template<uint8_t t_b, uint8_t t_k>
+constexpr std::array<uint8_t,t_b> perm<t_b,t_k>::mi_permute_block_sizes;
+
+template<uint8_t t_b, uint8_t t_k>
+constexpr std::array<std::array<uint8_t,t_b>,perm<t_b,t_k>::num_perms> perm<t_b,t_k>::mi_permute_block_widths;
+
+template<uint8_t t_b, uint8_t t_k>
+constexpr std::array<std::array<uint8_t,t_b>,perm<t_b,t_k>::num_perms> perm<t_b,t_k>::mi_permute_block_widths_sums;
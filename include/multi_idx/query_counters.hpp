@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace multi_index {
+
+//! Counter slots of query_counters
+enum class query_counter : uint8_t {
+    buckets_probed,      // bucket ranges scanned
+    candidates_scanned,  // entries in the scanned ranges or clusters
+    prefilter_survivors, // entries passing the filter on the low bits (SIMD or scalar)
+    verify_survivors,    // entries within the search radius
+    clusters_visited,    // clusters whose entries were scanned
+    clusters_skipped,    // clusters excluded by the distance to their pivot
+    early_exits,         // cluster scans stopped because all remaining matches were found
+    size
+};
+
+constexpr size_t query_counter_slots = (size_t)query_counter::size;
+
+//! Values of all counters, e.g. the sum over all threads
+struct query_counts {
+    std::array<uint64_t, query_counter_slots> values{};
+
+    uint64_t& operator[](query_counter c) { return values[(size_t)c]; }
+    uint64_t operator[](query_counter c) const { return values[(size_t)c]; }
+
+    query_counts& operator+=(const query_counts& x) {
+        for (size_t i=0; i < query_counter_slots; ++i) values[i] += x.values[i];
+        return *this;
+    }
+
+    //! Counts between an earlier snapshot x and this one
+    query_counts operator-(const query_counts& x) const {
+        query_counts d;
+        for (size_t i=0; i < query_counter_slots; ++i) d.values[i] = values[i] - x.values[i];
+        return d;
+    }
+
+    static const char* name(query_counter c) {
+        static const char* names[query_counter_slots] = {
+            "buckets_probed", "candidates_scanned", "prefilter_survivors", "verify_survivors",
+            "clusters_visited", "clusters_skipped", "early_exits"
+        };
+        return names[(size_t)c];
+    }
+};
+
+/*! Always-on query counters.
+ *
+ *  \par Every thread owns a block with one slot per counter, so the query
+ *       path neither locks nor shares cache lines. Only the owning thread
+ *       writes its slots (relaxed load and store, no read-modify-write), the
+ *       atomics only make concurrent reads by aggregate() tear-free.
+ *       aggregate() sums the blocks of all running threads plus the counts of
+ *       exited threads. Counts only grow; subtract two snapshots to get the
+ *       counts of an interval, e.g. of a single query via thread_counts().
+ */
+class query_counters {
+    private:
+        struct block;
+
+        struct registry {
+            std::mutex          mtx;
+            std::vector<block*> blocks;
+            query_counts        retired; // counts of exited threads
+        };
+
+        static registry& get_registry() {
+            static registry r;
+            return r;
+        }
+
+        struct block {
+            std::array<std::atomic<uint64_t>, query_counter_slots> slots;
+
+            block() {
+                for (auto& s : slots) s.store(0, std::memory_order_relaxed);
+                registry& r = get_registry();
+                std::lock_guard<std::mutex> lock(r.mtx);
+                r.blocks.push_back(this);
+            }
+
+            ~block() {
+                registry& r = get_registry();
+                std::lock_guard<std::mutex> lock(r.mtx);
+                r.retired += counts();
+                r.blocks.erase(std::find(r.blocks.begin(), r.blocks.end(), this));
+            }
+
+            query_counts counts() const {
+                query_counts c;
+                for (size_t i=0; i < query_counter_slots; ++i) {
+                    c.values[i] = slots[i].load(std::memory_order_relaxed);
+                }
+                return c;
+            }
+        };
+
+        static block& local() {
+            static thread_local block b;
+            return b;
+        }
+
+    public:
+        //! Adds counts to the block of the calling thread
+        static void add(const query_counts& c) {
+            block& b = local();
+            for (size_t i=0; i < query_counter_slots; ++i) {
+                if ( c.values[i] != 0 ) {
+                    b.slots[i].store(b.slots[i].load(std::memory_order_relaxed) + c.values[i], std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //! Counts of the calling thread
+        static query_counts thread_counts() {
+            return local().counts();
+        }
+
+        //! Counts of all threads
+        static query_counts aggregate() {
+            registry& r = get_registry();
+            std::lock_guard<std::mutex> lock(r.mtx);
+            query_counts c = r.retired;
+            for (const block* b : r.blocks) {
+                c += b->counts();
+            }
+            return c;
+        }
+};
+
+/*! Counters of one bucket scan. A strategy class creates it on the stack at
+ *  the start of a scan and counts into plain integers; the destructor adds
+ *  them to query_counters once, also if the scan returns early.
+ */
+class scan_stats {
+    private:
+        query_counts m_counts;
+
+    public:
+        //! Counts a probed bucket with candidates entries
+        explicit scan_stats(uint64_t candidates) {
+            m_counts[query_counter::buckets_probed] = 1;
+            m_counts[query_counter::candidates_scanned] = candidates;
+        }
+
+        scan_stats(const scan_stats&) = delete;
+        scan_stats& operator=(const scan_stats&) = delete;
+
+        ~scan_stats() {
+            query_counters::add(m_counts);
+        }
+
+        void candidates(uint64_t n) { m_counts[query_counter::candidates_scanned] += n; }
+        void prefiltered() { ++m_counts[query_counter::prefilter_survivors]; }
+        void verified() { ++m_counts[query_counter::verify_survivors]; }
+        void cluster_visited() { ++m_counts[query_counter::clusters_visited]; }
+        void cluster_skipped() { ++m_counts[query_counter::clusters_skipped]; }
+        void early_exit() { ++m_counts[query_counter::early_exits]; }
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "multi_idx/thread_pool.hpp"
+
+namespace multi_index {
+
+//! Allocator of cache line aligned objects for C++14, which ignores alignas in operator new
+template<typename T>
+struct cache_aligned_allocator {
+    typedef T value_type;
+    static constexpr size_t alignment = 64;
+
+    cache_aligned_allocator() = default;
+    template<typename U>
+    cache_aligned_allocator(const cache_aligned_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* p = nullptr;
+        if ( posix_memalign(&p, alignment, n*sizeof(T)) != 0 ) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) { free(p); }
+
+    template<typename U>
+    bool operator==(const cache_aligned_allocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const cache_aligned_allocator<U>&) const { return false; }
+};
+
+//! Aggregated result of a query_engine run
+struct query_stats {
+    uint64_t              queries = 0;
+    uint64_t              candidates = 0;
+    uint64_t              matches = 0;
+    uint64_t              unique_matches = 0;
+    double                elapsed_s = 0;
+    std::vector<uint64_t> latencies_ns; // latency of query i, sorted after the run
+
+    double queries_per_second() const {
+        return elapsed_s > 0 ? queries / elapsed_s : 0;
+    }
+
+    //! Latency percentile p in [0,100] in microseconds
+    double latency_percentile_us(double p) const {
+        if ( latencies_ns.empty() ) return 0;
+        size_t idx = (size_t)std::ceil(p/100.0 * latencies_ns.size());
+        idx = std::min(latencies_ns.size()-1, idx == 0 ? 0 : idx-1);
+        return latencies_ns[idx] / 1000.0;
+    }
+};
+
+/*! Answers a set of queries in parallel.
+ *  \tparam t_index An index class like multi_idx or multi_idx_red.
+ *
+ *  \par The query set is cut into small chunks which are distributed by the
+ *       work-stealing thread_pool, since the cost of a query varies a lot
+ *       between dense and empty buckets. Each slot of the pool accumulates
+ *       into its own result buffer, so threads do not share any written
+ *       state except the per-query latency slots.
+ */
+template<typename t_index>
+class query_engine {
+    private:
+        // One cache line per slot, so that the counters of the slots do not share one
+        struct alignas(64) thread_result {
+            uint64_t              candidates = 0;
+            uint64_t              matches = 0;
+            uint64_t              unique_matches = 0;
+            std::vector<uint64_t> buffer;         // reused result buffer of the queries
+        };
+
+        const t_index&             m_idx;
+        thread_pool&               m_pool;
+        std::vector<thread_result, cache_aligned_allocator<thread_result>> m_results;
+
+    public:
+        query_engine(const t_index& idx, thread_pool& pool) : m_idx(idx), m_pool(pool), m_results(pool.size()) {}
+
+        /*! Matches queries[0..n)
+         *  \param find_only_candidates Only count candidates (see match).
+         *  \param radius               Search radius in [0, t_index::k].
+         *  \param grain                Number of queries per chunk.
+         */
+        query_stats run(const uint64_t* queries, size_t n, const bool find_only_candidates=false, int radius=t_index::k, size_t grain=16) {
+            typedef std::chrono::high_resolution_clock clock;
+            for (auto& r : m_results) {
+                r.candidates = r.matches = r.unique_matches = 0;
+            }
+            query_stats stats;
+            stats.queries = n;
+            stats.latencies_ns.resize(n);
+
+            auto start = clock::now();
+            m_pool.parallel_for(n, grain, [&](size_t begin, size_t end, size_t slot){
+                auto& r = m_results[slot];
+                for (size_t i=begin; i < end; ++i) {
+                    auto q_start = clock::now();
+                    r.buffer.clear();
+                    if ( find_only_candidates ) {
+                        r.candidates += std::get<1>(m_idx.match(queries[i], radius, true));
+                    } else {
+                        r.candidates += m_idx.match(queries[i], r.buffer, radius);
+                    }
+                    auto q_stop = clock::now();
+                    stats.latencies_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(q_stop-q_start).count();
+                    if ( !find_only_candidates ) {
+                        r.matches += r.buffer.size();
+                        std::sort(r.buffer.begin(), r.buffer.end());
+                        r.unique_matches += std::unique(r.buffer.begin(), r.buffer.end()) - r.buffer.begin();
+                    }
+                }
+            });
+            auto stop = clock::now();
+            stats.elapsed_s = std::chrono::duration_cast<std::chrono::duration<double>>(stop-start).count();
+
+            for (auto& r : m_results) {
+                stats.candidates += r.candidates;
+                stats.matches += r.matches;
+                stats.unique_matches += r.unique_matches;
+            }
+            std::sort(stats.latencies_ns.begin(), stats.latencies_ns.end());
+            return stats;
+        }
+};
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace multi_index {
+
+/*! A (sub-)query of a batch which was mapped to a bucket of one permutation.
+ *  Batches are sorted by bucket before they are passed to a strategy class,
+ *  so that every bucket range is located and scanned once per batch.
+ */
+struct batch_query {
+    uint64_t key;    // query key (in multi_idx_red possibly with flipped bits)
+    uint64_t bucket; // bucket of key under the current permutation
+    uint32_t id;     // position of the query in the batch
+    uint8_t  errors; // number of errors allowed for this (sub-)query
+
+    bool operator<(const batch_query& other) const {
+        return bucket < other.bucket or (bucket == other.bucket and id < other.id);
+    }
+};
+
+/*! Collects the results of a batch of queries in one flat buffer.
+ *
+ *  During matching the strategy classes append (query id, key) pairs in
+ *  arbitrary order. finalize() groups them by query id with a counting sort,
+ *  such that the matches of query i are stored in
+ *  matches[offsets[i]..offsets[i+1]) and candidates[i] is the number of
+ *  candidates checked for query i.
+ *
+ *  A sink can be reused for several batches; its buffers keep their capacity.
+ */
+class result_sink {
+    public:
+        std::vector<uint64_t> matches;
+        std::vector<uint64_t> offsets;
+        std::vector<uint64_t> candidates;
+
+    private:
+        std::vector<uint32_t> m_ids;  // query ids of the pending matches
+        std::vector<uint64_t> m_keys; // pending matches
+
+    public:
+        //! Prepares the sink for a batch of n queries
+        void reset(size_t n) {
+            matches.clear();
+            offsets.assign(n+1, 0);
+            candidates.assign(n, 0);
+            m_ids.clear();
+            m_keys.clear();
+        }
+
+        inline void add(uint32_t id, uint64_t key) {
+            m_ids.push_back(id);
+            m_keys.push_back(key);
+        }
+
+        inline void add_candidates(uint32_t id, uint64_t cnt) {
+            candidates[id] += cnt;
+        }
+
+        //! Groups the pending matches by query id
+        void finalize() {
+            const size_t n = candidates.size();
+            for (auto id : m_ids) {
+                ++offsets[id+1];
+            }
+            for (size_t i = 1; i <= n; ++i) {
+                offsets[i] += offsets[i-1];
+            }
+            matches.resize(m_keys.size());
+            std::vector<uint64_t> pos(offsets.begin(), offsets.end()-1);
+            for (size_t i = 0; i < m_keys.size(); ++i) {
+                matches[pos[m_ids[i]]++] = m_keys[i];
+            }
+            m_ids.clear();
+            m_keys.clear();
+        }
+
+        //! Number of queries in the batch
+        size_t size() const {
+            return candidates.size();
+        }
+
+        //! Number of matches of query i (after finalize())
+        size_t size(size_t i) const {
+            return offsets[i+1] - offsets[i];
+        }
+
+        std::vector<uint64_t>::const_iterator begin(size_t i) const {
+            return matches.begin() + offsets[i];
+        }
+
+        std::vector<uint64_t>::const_iterator end(size_t i) const {
+            return matches.begin() + offsets[i+1];
+        }
+};
+
+}
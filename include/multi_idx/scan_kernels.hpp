@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <xmmintrin.h>
+
+namespace multi_index {
+
+/*! Filter kernels for the low entries of the split strategies.
+ *
+ *  A kernel writes all positions i in [0,n) with popcount(a[i]^q) <= errors
+ *  in increasing order to out and returns their number. out has to provide
+ *  space for n positions. The kernels only differ in the instruction set
+ *  they use: plain C++, SSE4.2 (4 lanes), AVX2 (8 lanes) and AVX-512
+ *  (16 lanes). Each kernel lives in its own translation unit in lib/ which
+ *  is compiled with the flags of its instruction set, while the rest of the
+ *  code only requires x86-64. The best kernel which is supported by the CPU
+ *  is selected at runtime (see get_scan_kernel()).
+ */
+typedef size_t (*scan_kernel_type)(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+
+struct scan_kernel_info {
+    const char*      name;
+    scan_kernel_type kernel;
+};
+
+namespace scan_kernels {
+
+size_t plain(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+size_t sse42(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+size_t avx2(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+size_t avx512(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+size_t avx512_vpopcntdq(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out);
+
+} // end namespace scan_kernels
+
+//! Selects the widest kernel the executing CPU supports
+scan_kernel_info select_scan_kernel();
+
+//! The kernel used by the split strategies; selected once per process
+const scan_kernel_info& get_scan_kernel();
+
+//! Number of low entries which are filtered per kernel call
+constexpr size_t scan_block_size = 256;
+
+/*! Calls report(i) for all positions i in [0,n) with popcount(a[i]^q) <= errors
+ *  using the kernel selected by get_scan_kernel(). report returns false to
+ *  stop the scan early, e.g. after the first verified match.
+ *  \return false if the scan was stopped by report.
+ */
+template<typename t_report>
+inline bool filter_low_entries(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, t_report&& report) {
+    const scan_kernel_type kernel = get_scan_kernel().kernel;
+    uint32_t pos[scan_block_size];
+    for (size_t b = 0; b < n; b += scan_block_size) {
+        const size_t len = std::min(scan_block_size, n-b);
+        _mm_prefetch((const char*)(a+b+len), _MM_HINT_T0);
+        const size_t m = kernel(a+b, len, q, errors, pos);
+        for (size_t j = 0; j < m; ++j) {
+            if ( !report(b+pos[j]) ) return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -8,6 +8,10 @@
 #include "sdsl/int_vector.hpp"
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
+#include "multi_idx/mmap_io.hpp"
 
 namespace multi_index {
   
@@ -29,38 +33,34 @@ private:
         return i < perm_b_k::match_len ? perm_b_k::mi_permute_block_widths[t_id][t_b-1-i] + init_splitter_bits(i+1) : 0;
     }
     uint64_t              m_n;      // number of items
-    sdsl::int_vector<64>  m_entries; 
+    mappable_int_vector<64> m_entries; 
+    payload_vector        m_payloads; // payloads in the order of m_entries
 
 public:
     static constexpr uint8_t splitter_bits = init_splitter_bits(0);
 
     _simple_buckets_binsearch() = default;
 
-    _simple_buckets_binsearch(const std::vector<entry_type> &input_entries) {
+    _simple_buckets_binsearch(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+        _simple_buckets_binsearch(key_source(input_entries, payloads), pool) {}
+
+    //! Builds the index from keys in memory or streamed from a file
+    _simple_buckets_binsearch(const key_source &input_entries, thread_pool* pool=nullptr) {
         std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl; 
 
         m_n = input_entries.size();
-        sdsl::int_vector<64>(input_entries.size(), 0).swap(m_entries);
+        m_entries = sdsl::int_vector<64>(input_entries.size(), 0);
+        m_payloads = payload_vector(input_entries);
         
-        if(splitter_bits <= 28) build_small_universe(input_entries);
+        if(splitter_bits <= 28) build_small_universe(input_entries, pool);
         else build_large_universe(input_entries);
     }
 
-    inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false) {
+    inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
         uint64_t bucket = get_bucket_id(q);
-
-        auto begin = std::lower_bound(m_entries.begin(), 
-                                      m_entries.end(), 
-                                      bucket,
-                                      [&](const entry_type &a, const entry_type &bucket) {
-                                            return get_bucket_id(a) < bucket;}
-                     );
-        auto end = std::upper_bound(begin, 
-                                    m_entries.end(), 
-                                    bucket,
-                                    [&](const entry_type &bucket, const entry_type &b) {
-                                            return bucket < get_bucket_id(b);}
-                    );
+        auto range = bucket_range(bucket);
+        auto begin = range.first;
+        auto end = range.second;
 
         uint64_t candidates = std::distance(begin,end);
         std::vector<entry_type> res;
@@ -68,17 +68,79 @@ public:
         if (find_only_candidates) return {res, candidates};
         if (errors >= 6) res.reserve(128);
 
-        for (auto it = begin; it != end; ++it) {
-          if (sdsl::bits::cnt(q^*it) <= errors) {
-            res.push_back(*it);
-          }
-        }
+        scan(q, errors, begin, end, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
         return {res, candidates};
     }
 
+    /*! Calls report(x, i) for all entries x within distance errors of q in the
+     *  bucket of q, where i is the position of x in the entry arrays. Stops
+     *  as soon as report returns false. Entries are reported as they are
+     *  stored, i.e. without applying the reverse permutation (see get_key).
+     *  \return The number of candidates like match.
+     */
+    template<typename t_report>
+    uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+        auto range = bucket_range(get_bucket_id(q));
+        scan(q, errors, range.first, range.second, report);
+        return std::distance(range.first, range.second);
+    }
+
+    /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+     *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+     *  with radius - popcount(masks[j]) errors. There is no bucket directory,
+     *  so the sub-queries are simply visited one after another.
+     *  Stops as soon as report returns false.
+     *  \return The number of candidates of all sub-queries.
+     */
+    template<typename t_report>
+    uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+        uint64_t candidates = 0;
+        bool go_on = true;
+        for (size_t j = 0; j < n and go_on; ++j) {
+            const uint64_t q = perm_b_k::template rev_permute<t_id>(q_permuted ^ masks[j]);
+            candidates += visit(q, radius - sdsl::bits::cnt(masks[j]), [&](uint64_t x, uint64_t i) { return go_on = report(x, i, j); });
+        }
+        return candidates;
+    }
+
+    /*! Calls report(x, i) like visit for all entries, e.g. for a linear
+     *  scan. Stops as soon as report returns false.
+     */
+    template<typename t_report>
+    void visit_all(t_report&& report) const {
+        scan(0, 64, m_entries.begin(), m_entries.end(), report);
+    }
+
+    //! Key of an entry x reported by visit
+    static uint64_t get_key(const uint64_t x) {
+        return x;
+    }
+
+    //! Key of an entry x reported by visit under the permutation of this index
+    static uint64_t get_permuted_key(const uint64_t x) {
+        return perm_b_k::template permute<t_id>(x);
+    }
+
+    //! Matches a batch of (sub-)queries which is sorted by bucket
+    template<typename t_sink>
+    void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+        while ( first != last ) {
+            const uint64_t bucket = first->bucket;
+            auto range = bucket_range(bucket);
+            for (; first != last and first->bucket == bucket; ++first) {
+                const uint32_t qid = first->id;
+                sink.add_candidates(qid, std::distance(range.first, range.second));
+                if ( !find_only_candidates ) {
+                    scan(first->key, first->errors, range.first, range.second, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; });
+                }
+            }
+        }
+    }
+
     _simple_buckets_binsearch& operator=(const _simple_buckets_binsearch& idx) {
         if ( this != &idx ) {
             m_n       = std::move(idx.m_n);
+            m_payloads    = std::move(idx.m_payloads);
             m_entries   = std::move(idx.m_entries);
         }
         return *this;
@@ -87,6 +149,7 @@ public:
     _simple_buckets_binsearch& operator=(_simple_buckets_binsearch&& idx) {
         if ( this != &idx ) {
             m_n       = std::move(idx.m_n);
+            m_payloads    = std::move(idx.m_payloads);
             m_entries   = std::move(idx.m_entries);
         }
         return *this;
@@ -107,6 +170,7 @@ public:
         uint64_t written_bytes = 0;
         written_bytes += write_member(m_n, out, child, "n");
         written_bytes += m_entries.serialize(out, child, "entries");      
+        written_bytes += m_payloads.serialize(out, child, "payloads");
         structure_tree::add_size(child, written_bytes);
         return written_bytes;
     }
@@ -116,49 +180,87 @@ public:
         using namespace sdsl;
         read_member(m_n, in);
         m_entries.load(in);
+        m_payloads.load(in);
     }
 
     size_type size() const{
         return m_n;
     }
 
-private:
+    //! True if the entries live in a memory mapping, see load_from_file_mapped
+    bool is_mapped() const {
+        return m_entries.is_mapped();
+    }
 
   inline uint64_t get_bucket_id(const uint64_t x) const {
-      return perm_b_k::mi_permute[t_id](x) >> (64-splitter_bits);
+      return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits);
   }
 
+private:
+
+  typedef mappable_int_vector<64>::const_iterator entry_iterator;
+
+  inline std::pair<entry_iterator, entry_iterator> bucket_range(const uint64_t bucket) const {
+      auto begin = std::lower_bound(m_entries.begin(), 
+                                    m_entries.end(), 
+                                    bucket,
+                                    [&](const entry_type &a, const entry_type &bucket) {
+                                          return get_bucket_id(a) < bucket;}
+                   );
+      auto end = std::upper_bound(begin, 
+                                  m_entries.end(), 
+                                  bucket,
+                                  [&](const entry_type &bucket, const entry_type &b) {
+                                          return bucket < get_bucket_id(b);}
+                  );
+      return {begin, end};
+  }
 
-void build_large_universe(const std::vector<entry_type> &input_entries) {
-    std::copy(input_entries.begin(), input_entries.end(), m_entries.begin());   
+  // Scans the entries in [begin, end) and reports all keys within distance errors of q
+  // as report(entry, position of the entry in the entry arrays), see get_key.
+  // Stops as soon as report returns false.
+  template<typename t_report>
+  inline void scan(const entry_type q, uint8_t errors, entry_iterator begin, entry_iterator end, t_report&& report) const {
+      scan_stats stats(end-begin);
+      for (auto it = begin; it != end; ++it) {
+        if (sdsl::bits::cnt(q^*it) <= errors) {
+          stats.verified();
+          if ( !report(*it, it - m_entries.begin()) ) return;
+        }
+      }
+  }
+
+
+void build_large_universe(const key_source &input_entries) {
+    std::vector<uint64_t> keys, payloads; // only kept for the payloads
+    size_t i = 0;
+    input_entries.for_each([&](uint64_t x, uint64_t payload) {
+        m_entries[i++] = x;
+        if ( !m_payloads.empty() ) {
+            keys.push_back(x);
+            payloads.push_back(payload);
+        }
+    });
     std::cout << "Start sorting\n";
     std::sort(m_entries.begin(), m_entries.end(), 
         [&](const entry_type &a, const entry_type &b) {
             return get_bucket_id(a) < get_bucket_id(b);
     });
     std::cout << "End sorting\n";   
+    if ( !m_payloads.empty() ) {
+        m_payloads.assign_by_key(keys, payloads, std::vector<uint64_t>(m_entries.begin(), m_entries.end()));
+    }
 }
 
-void build_small_universe(const std::vector<entry_type> &input_entries) {
+void build_small_universe(const key_source &input_entries, thread_pool* pool) {
     // countingSort-like strategy to order entries accordingly to bucket_id
     uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
-    std::vector<uint64_t> prefix_sums(splitter_universe + 1, 0); // includes a sentinel
-    for (auto x : input_entries) {
-        prefix_sums[get_bucket_id(x)]++;
-    }
-
-    uint64_t sum = prefix_sums[0];
-    prefix_sums[0] = 0;
-    for(uint64_t i = 1; i < prefix_sums.size(); ++i) {
-        uint64_t curr = prefix_sums[i];
-        prefix_sums[i] = sum; 
-        sum += curr;
-    }
-    for (auto x : input_entries) {
-        uint64_t bucket = get_bucket_id(x);
-        m_entries[prefix_sums[bucket]] = x; 
-        prefix_sums[bucket]++;
-    }
+    bucket_scatter(input_entries, splitter_universe,
+        [&](uint64_t x) { return get_bucket_id(x); },
+        [&](uint64_t j, uint64_t x, uint64_t payload) {
+            m_entries[j] = x;
+            if ( !m_payloads.empty() ) m_payloads.set(j, payload);
+        }, pool);
 }
 
 };
@@ -8,7 +8,11 @@
 #include "sdsl/int_vector.hpp"
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
+#include "multi_idx/mappable_bit_vector.hpp"
 #include "multi_idx/multi_idx_helper.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
 
 namespace multi_index {
  
@@ -17,7 +21,7 @@ namespace multi_index {
            uint8_t t_k=3,
            size_t  t_id=0, // id of the permutation managed by this instance
            typename perm_b_k=perm<t_b,t_b-t_k>,
-           typename t_bv=sdsl::bit_vector,
+           typename t_bv=mappable_bit_vector,
            typename t_sel=typename t_bv::select_1_type> 
   class _simple_buckets_binvector {
     public:
@@ -32,48 +36,138 @@ namespace multi_index {
         }
 
         uint64_t              m_n;      // number of items
-        sdsl::int_vector<64>  m_entries;
+        mappable_int_vector<64> m_entries;
         t_bv                  m_C;     // bit vector for prefix sums of meta-symbols
         t_sel                 m_C_sel; // select1 structure for m_C 
+        payload_vector        m_payloads; // payloads in the order of the entries
 
     public:
         static constexpr uint8_t    splitter_bits = init_splitter_bits(0);
 
         _simple_buckets_binvector() = default;
 
-        _simple_buckets_binvector(const std::vector<entry_type> &input_entries) {
+        _simple_buckets_binvector(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+            _simple_buckets_binvector(key_source(input_entries, payloads), pool) {}
+
+        //! Builds the index from keys in memory or streamed from a file
+        _simple_buckets_binvector(const key_source &input_entries, thread_pool* pool=nullptr) {
             std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl; 
     
             m_n = input_entries.size();
             m_entries = sdsl::int_vector<64>(input_entries.size(), 0);
             
-            build_small_universe(input_entries);
+            m_payloads = payload_vector(input_entries);
+            
+            build_small_universe(input_entries, pool);
         }
 
         // assert(errors <= t_k)
-        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false) {
+        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
             uint64_t bucket = get_bucket_id(q);
     
-            const auto l = bucket == 0 ? 0 : m_C_sel(bucket) - bucket +1; 
-            const auto r = m_C_sel(bucket+1) - (bucket+1) +1;  
-            
-            auto begin = m_entries.begin() + l;
-            auto end = m_entries.begin() + r;
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
     
-            uint64_t candidates = std::distance(begin,end);
+            uint64_t candidates = r-l;
             std::vector<entry_type> res;
             
             if(find_only_candidates) return {res, candidates};
+            scan(q, errors, l, r, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
+            return {res, candidates};
+        }
+
+        /*! Calls report(x, i) for all entries x within distance errors of q in the
+         *  bucket of q, where i is the position of x in the entry arrays. Stops
+         *  as soon as report returns false. Entries are reported as they are
+         *  stored, i.e. without applying the reverse permutation (see get_key).
+         *  \return The number of candidates like match.
+         */
+        template<typename t_report>
+        uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
+            scan(q, errors, l, r, report);
+            return r-l;
+        }
+
+        /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+         *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+         *  with radius - popcount(masks[j]) errors. The bucket ranges of a chunk
+         *  of sub-queries are located together, see visit_bucket_masks.
+         *  Stops as soon as report returns false.
+         *  \return The number of candidates of all sub-queries.
+         */
+        template<typename t_report>
+        uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+            return visit_bucket_masks(m_C, m_C_sel, q_permuted, masks, n, radius,
+                [](uint64_t x) { return perm_b_k::template rev_permute<t_id>(x); },
+                [&](uint64_t q) { return get_bucket_id(q); },
+                [&](uint64_t q, uint8_t errors, uint64_t, uint64_t l, uint64_t r, auto&& rep) { scan(q, errors, l, r, rep); return r-l; },
+                report);
+        }
+
+        /*! Calls report(x, i) like visit for all entries, e.g. for a linear
+         *  scan. Stops as soon as report returns false.
+         */
+        template<typename t_report>
+        void visit_all(t_report&& report) const {
+            scan(0, 64, 0, m_n, report);
+        }
+
+        //! Key of an entry x reported by visit
+        static uint64_t get_key(const uint64_t x) {
+            return x;
+        }
+
+        //! Key of an entry x reported by visit under the permutation of this index
+        static uint64_t get_permuted_key(const uint64_t x) {
+            return perm_b_k::template permute<t_id>(x);
+        }
+
+        //! Matches a batch of (sub-)queries which is sorted by bucket
+        template<typename t_sink>
+        void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            while ( first != last ) {
+                const uint64_t bucket = first->bucket;
+                const auto range = bucket_range(m_C, m_C_sel, bucket);
+                const auto l = range.first;
+                const auto r = range.second;
+                for (; first != last and first->bucket == bucket; ++first) {
+                    const uint32_t qid = first->id;
+                    sink.add_candidates(qid, r-l);
+                    if ( !find_only_candidates ) {
+                        scan(first->key, first->errors, l, r, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; });
+                    }
+                }
+            }
+        }
+
+    private:
+        // Scans the entries in [l, r) and reports all keys within distance errors of q
+        // as report(entry, position of the entry in the entry arrays), see get_key.
+        // Stops as soon as report returns false.
+        template<typename t_report>
+        inline void scan(const entry_type q, uint8_t errors, const uint64_t l, const uint64_t r, t_report&& report) const {
+            auto begin = m_entries.begin() + l;
+            auto end = m_entries.begin() + r;
+            scan_stats stats(r-l);
             for (auto it = begin; it != end; ++it) {
-               if (sdsl::bits::cnt(q^*it) <= errors)
-                 res.push_back(*it);
+               if (sdsl::bits::cnt(q^*it) <= errors) {
+                 stats.verified();
+                 if ( !report(*it, it - m_entries.begin()) ) return;
+               }
             }
-            return {res, candidates};
         }
+
+    public:
   
         _simple_buckets_binvector& operator=(const _simple_buckets_binvector& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_entries   = std::move(idx.m_entries);
                 m_C           = std::move(idx.m_C);
                 m_C_sel       = std::move(idx.m_C_sel);
@@ -85,6 +179,7 @@ namespace multi_index {
         _simple_buckets_binvector& operator=(_simple_buckets_binvector&& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_entries   = std::move(idx.m_entries);
                 m_C           = std::move(idx.m_C);
                 m_C_sel       = std::move(idx.m_C_sel);
@@ -110,6 +205,7 @@ namespace multi_index {
             written_bytes += m_entries.serialize(out, child, "entries"); 
             written_bytes += m_C.serialize(out, child, "C");
             written_bytes += m_C_sel.serialize(out, child, "C_sel");     
+            written_bytes += m_payloads.serialize(out, child, "payloads");
             structure_tree::add_size(child, written_bytes);
             return written_bytes;
         }
@@ -121,26 +217,34 @@ namespace multi_index {
             m_entries.load(in);
             m_C.load(in);
             m_C_sel.load(in, &m_C);
+            m_payloads.load(in);
         }
 
         size_type size() const{
             return m_n;
         }
 
-private:
+        //! True if the entries and the bucket directory live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            return m_entries.is_mapped() and m_C.is_mapped();
+        }
 
     inline uint64_t get_bucket_id(const uint64_t x) const {
-        return perm_b_k::mi_permute[t_id](x) >> (64-splitter_bits);
+        return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits);
     }
 
-    void build_small_universe(const std::vector<entry_type> &input_entries) {
+private:
+
+    void build_small_universe(const key_source &input_entries, thread_pool* pool) {
         // countingSort-like strategy to order entries accordingly to bucket_id
         uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
 
-        std::vector<uint64_t> prefix_sums(splitter_universe + 1, 0); 
-        for (auto x: input_entries) {
-            prefix_sums[get_bucket_id(x)]++;
-        }
+        const std::vector<uint64_t> prefix_sums = bucket_scatter(input_entries, splitter_universe,
+            [&](uint64_t x) { return get_bucket_id(x); },
+            [&](uint64_t j, uint64_t x, uint64_t payload) {
+                m_entries[j] = x;
+                if ( !m_payloads.empty() ) m_payloads.set(j, payload);
+            }, pool); // includes a sentinel
         
         m_C = t_bv(splitter_universe+input_entries.size(), 0);
         size_t idx = 0;
@@ -150,23 +254,10 @@ private:
           m_C[idx++] = 1;
         }
         m_C_sel = t_sel(&m_C);
-
-        uint64_t sum = prefix_sums[0];
-        prefix_sums[0] = 0;
-        for(uint64_t i = 1; i < prefix_sums.size(); ++i) {
-            uint64_t curr = prefix_sums[i];
-            prefix_sums[i] = sum;
-            sum += curr;
-        }
-        for (auto x : input_entries) {
-            uint64_t bucket = get_bucket_id(x);
-            m_entries[prefix_sums[bucket]] = x; 
-            prefix_sums[bucket]++;
-        }
     }
 };
 
-  template<typename t_bv=sdsl::bit_vector,
+  template<typename t_bv=mappable_bit_vector,
            typename t_sel=typename t_bv::select_1_type> 
   struct simple_buckets_binvector {
       template<uint8_t t_b, uint8_t t_k, size_t t_id, typename t_perm>
@@ -10,8 +10,12 @@
 #include "sdsl/int_vector.hpp"
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
+#include "multi_idx/mappable_bit_vector.hpp"
 #include "multi_idx/multi_idx_helper.hpp"
-#include "simd_utils.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
+#include "multi_idx/scan_kernels.hpp"
 
 #define LIKELY(x)   (__builtin_expect((x), 1))
 #define UNLIKELY(x) (__builtin_expect((x), 0))
@@ -40,7 +44,9 @@ namespace multi_index {
         /* Low_* stuff control how many of the less signifigant bits form the lower part */
         static constexpr uint8_t    low_bits    = 32; // PLS, keep this a power of 2, better if word aligned
         static constexpr uint64_t   low_mask    = (1ULL<<low_bits)-1;
+    public:
         static constexpr uint8_t    splitter_bits = init_splitter_bits(0);
+    protected:
         static constexpr uint8_t    mid_bits = 64 - (low_bits + splitter_bits);
         static constexpr uint8_t    mid_shift   = low_bits; 
         static constexpr uint64_t   mid_mask = (1ULL<<mid_bits)-1;
@@ -48,29 +54,36 @@ namespace multi_index {
         using  mid_entries_type = typename mid_entries_trait<mid_bits>::type; 
 
         uint64_t                    m_n;      // number of items
-        sdsl::int_vector<low_bits>  m_low_entries;
+        mappable_int_vector<low_bits> m_low_entries;
         mid_entries_type            m_mid_entries; 
         //sdsl::int_vector<64>  fake_entries; for DEBUG USE ONLY
         t_bv                        m_C;     // bit vector for prefix sums of meta-symbols
         t_sel                       m_C_sel; // select1 structure for m_C
+        payload_vector              m_payloads; // payloads in the order of the entries
 
     public:
         _simple_buckets_binvector_split_common() = default;
 
-        _simple_buckets_binvector_split_common(const std::vector<entry_type> &input_entries){
+        _simple_buckets_binvector_split_common(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+            _simple_buckets_binvector_split_common(key_source(input_entries, payloads), pool) {}
+
+        //! Builds the index from keys in memory or streamed from a file
+        _simple_buckets_binvector_split_common(const key_source &input_entries, thread_pool* pool=nullptr) {
             std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl; 
             m_n = input_entries.size();
             m_low_entries = sdsl::int_vector<low_bits>(input_entries.size(), 0); 
             m_mid_entries = mid_entries_trait<mid_bits>::get_instance(input_entries.size(), 0);
-            build_small_universe(input_entries);
+            m_payloads = payload_vector(input_entries);
+            build_small_universe(input_entries, pool);
         }
 
-        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false) const {
+        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
           
             const uint64_t bucket = get_bucket_id(q);
             
-            auto l = bucket == 0 ? 0 : m_C_sel(bucket) - bucket +1; 
-            const auto r = m_C_sel(bucket+1) - (bucket+1) + 1;  
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
     
            // std::cout << "q " << q << " b " << bucket << " l " << l << " r " <<  r << std::endl;
     
@@ -79,53 +92,108 @@ namespace multi_index {
             
             if(find_only_candidates) return {res, candidates};
             if(errors >= 6) res.reserve(128);
-  
-            const uint64_t q_permuted   = perm_b_k::mi_permute[t_id](q); 
+
+            scan(q, errors, l, r, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
+            return {res, candidates};
+        }
+
+        /*! Calls report(x, i) for all entries x within distance errors of q in the
+         *  bucket of q, where i is the position of x in the entry arrays. Stops
+         *  as soon as report returns false. Entries are reported as they are
+         *  stored, i.e. without applying the reverse permutation (see get_key).
+         *  \return The number of candidates like match.
+         */
+        template<typename t_report>
+        uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
+            scan(q, errors, l, r, report);
+            return r-l;
+        }
+
+        /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+         *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+         *  with radius - popcount(masks[j]) errors. The bucket ranges of a chunk
+         *  of sub-queries are located together, see visit_bucket_masks.
+         *  Stops as soon as report returns false.
+         *  \return The number of candidates of all sub-queries.
+         */
+        template<typename t_report>
+        uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+            return visit_bucket_masks(m_C, m_C_sel, q_permuted, masks, n, radius,
+                [](uint64_t x) { return perm_b_k::template rev_permute<t_id>(x); },
+                [&](uint64_t q) { return get_bucket_id(q); },
+                [&](uint64_t q, uint8_t errors, uint64_t, uint64_t l, uint64_t r, auto&& rep) { scan(q, errors, l, r, rep); return r-l; },
+                report);
+        }
+
+        /*! Calls report(x, i) like visit for all entries, bucket by bucket, e.g.
+         *  for a linear scan. Stops as soon as report returns false.
+         */
+        template<typename t_report>
+        void visit_all(t_report&& report) const {
+            bool go_on = true;
+            for_each_bucket(m_C, m_C_sel, 1ULL << splitter_bits, [&](uint64_t bucket, uint64_t l, uint64_t r) {
+                const uint64_t q = perm_b_k::template rev_permute<t_id>(bucket << (64-splitter_bits));
+                scan(q, 64, l, r, [&](uint64_t x, uint64_t i) { return go_on = report(x, i); });
+                return go_on;
+            });
+        }
+
+        //! Key of an entry x reported by visit
+        static uint64_t get_key(const uint64_t x) {
+            return perm_b_k::template rev_permute<t_id>(x);
+        }
+
+        //! Key of an entry x reported by visit under the permutation of this index
+        static uint64_t get_permuted_key(const uint64_t x) {
+            return x;
+        }
+
+        //! Matches a batch of (sub-)queries which is sorted by bucket
+        template<typename t_sink>
+        void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            while ( first != last ) {
+                const uint64_t bucket = first->bucket;
+                const auto range = bucket_range(m_C, m_C_sel, bucket);
+                const auto l = range.first;
+                const auto r = range.second;
+                for (; first != last and first->bucket == bucket; ++first) {
+                    const uint32_t qid = first->id;
+                    sink.add_candidates(qid, r-l);
+                    if ( !find_only_candidates ) {
+                        scan(first->key, first->errors, l, r, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; });
+                    }
+                }
+            }
+        }
+
+    protected:
+        // Scans the entries in [l, r) and reports all keys within distance errors of q
+        // as report(entry, position of the entry in the entry arrays), see get_key.
+        // Stops as soon as report returns false.
+        template<typename t_report>
+        inline void scan(const entry_type q, uint8_t errors, uint64_t l, const uint64_t r, t_report&& report) const {
+            const uint64_t q_permuted   = perm_b_k::template permute<t_id>(q); 
             const uint64_t q_high       = (q_permuted>>(high_shift))<<high_shift;
             const uint64_t q_low        = q_permuted & low_mask;
                                 
             const auto begin  = m_low_entries.begin() + l;
             const auto end    = m_low_entries.begin() + r;
+            scan_stats stats(r-l);
 
             if ( use_simd ) {
-                auto it = begin;
-                for (; ((size_t)it)%16 != 0 and it != end; ++it, ++l) {
-                  const uint32_t item_low = ((uint64_t) *it);   
-                  if UNLIKELY(_mm_popcnt_u32(q_low^item_low) <= errors) {
-                    const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l]) << mid_shift) | item_low;
-                    if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                      res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
-                  }
-                }
-                
-                const __m128i query = _mm_set1_epi32(q_low);
-                const __m128i tk    = _mm_set1_epi32(errors+1);
-
-                for(; it < end-4; it+=4, l+=4) {
-                  _mm_prefetch((const char *) (it+4), _MM_HINT_T0);
-                  const __m128i vec     = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(it)), query); // need to be aligned!
-                  const __m128i popcounts = popcount_epi32(vec); // not an intrinsics, see simd_utils.hpp
-     
-                  uint16_t mask = (_mm_movemask_epi8(_mm_cmpgt_epi32(tk, popcounts))) & 0x1111;
-
-                  while(UNLIKELY(mask)) {
-                    size_t i =  (__builtin_ffs(mask))-1;
-                    mask = mask ^ (1 << i);
-                    i = i/4;
-                    const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l+i]) << mid_shift) | it[i];
-                    if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                      res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
-                  }          
-                }
-                
-                for (; it != end; ++it, ++l) {
-                  const uint32_t item_low = ((uint64_t) *it);   
-                  if UNLIKELY(_mm_popcnt_u32(q_low^item_low) <= errors) {
-                    const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l]) << mid_shift) | item_low;
-                    if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                      res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
+                filter_low_entries(begin, end-begin, q_low, errors, [&](size_t i) {
+                  stats.prefiltered();
+                  const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l+i]) << mid_shift) | begin[i];
+                  if (sdsl::bits::cnt(q_permuted^curr_el) <= errors) {
+                    stats.verified();
+                    return report(curr_el, l+i);
                   }
-                }
+                  return true;
+                });
             } else {
                 for (auto it = begin; it != end; ++it, ++l) {
                    const uint64_t item_low = ((uint64_t) *it);
@@ -140,18 +208,22 @@ namespace multi_index {
                    // }
                 
                    if (sdsl::bits::cnt(q_low^item_low) <= errors) {
+                     stats.prefiltered();
                      const uint64_t curr_el = q_high | (((uint64_t) m_mid_entries[l]) << mid_shift) | item_low;
-                     if (sdsl::bits::cnt(q_permuted^curr_el) <= errors)
-                       res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
+                     if (sdsl::bits::cnt(q_permuted^curr_el) <= errors) {
+                       stats.verified();
+                       if ( !report(curr_el, l) ) return;
+                     }
                    }
                 }
             }
-            return {res, candidates};
         }
-  
+
+    public:
         _simple_buckets_binvector_split_common& operator=(const _simple_buckets_binvector_split_common& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_low_entries   = std::move(idx.m_low_entries);
                 m_mid_entries   = std::move(idx.m_mid_entries);
                 //fake_entries   = std::move(idx.fake_entries);           
@@ -165,6 +237,7 @@ namespace multi_index {
         _simple_buckets_binvector_split_common& operator=(_simple_buckets_binvector_split_common&& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_low_entries   = std::move(idx.m_low_entries);
                 m_mid_entries   = std::move(idx.m_mid_entries);
                 //fake_entries   = std::move(idx.fake_entries);                               
@@ -194,6 +267,7 @@ namespace multi_index {
             written_bytes += m_C.serialize(out, child, "C");
             written_bytes += m_C_sel.serialize(out, child, "C_sel");  
             //written_bytes += fake_entries.serialize(out, child, "fake");  
+            written_bytes += m_payloads.serialize(out, child, "payloads");
             structure_tree::add_size(child, written_bytes);
             return written_bytes;
         }
@@ -206,6 +280,7 @@ namespace multi_index {
             m_mid_entries.load(in);
             m_C.load(in);
             m_C_sel.load(in, &m_C);
+            m_payloads.load(in);
             //fake_entries.load(in);
         }
 
@@ -213,22 +288,33 @@ namespace multi_index {
             return m_n;
         }
 
-protected:
+        //! True if the entries and the bucket directory live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            return m_low_entries.is_mapped() and m_C.is_mapped();
+        }
+
+public:
 
     inline uint64_t get_bucket_id(const uint64_t x) const {
-        return perm_b_k::mi_permute[t_id](x) >> (64-splitter_bits);
+        return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits);
     }
 
-    void build_small_universe(const std::vector<entry_type> &input_entries) {
+protected:
+
+    void build_small_universe(const key_source &input_entries, thread_pool* pool) {
         // Implement a countingSort-like strategy to order entries accordingly to
         // their splitter_bits MOST significant bits
         // Ranges of keys having the same MSB are not sorted. 
         uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
 
-        std::vector<uint64_t> prefix_sums(splitter_universe + 1, 0); // includes a sentinel
-        for (auto x: input_entries) {
-            prefix_sums[get_bucket_id(x)]++;
-        }
+        const std::vector<uint64_t> prefix_sums = bucket_scatter(input_entries, splitter_universe,
+            [&](uint64_t x) { return get_bucket_id(x); },
+            [&](uint64_t j, uint64_t x, uint64_t payload) {
+                const uint64_t permuted_item = perm_b_k::template permute<t_id>(x);
+                mid_entries_trait<mid_bits>::assign(m_mid_entries, j, (permuted_item>>mid_shift) & mid_mask); 
+                m_low_entries[j] = (permuted_item & low_mask);
+                if ( !m_payloads.empty() ) m_payloads.set(j, payload);
+            }, pool); // includes a sentinel
         
         m_C = t_bv(splitter_universe+input_entries.size(), 0);
         size_t idx = 0;
@@ -238,25 +324,6 @@ protected:
           m_C[idx++] = 1;
         }
         m_C_sel = t_sel(&m_C);
-        
-        uint64_t sum = prefix_sums[0];
-        prefix_sums[0] = 0;
-        for(uint64_t i = 1; i < prefix_sums.size(); ++i) {
-            uint64_t curr = prefix_sums[i];
-            prefix_sums[i] = sum + i; // +i is to obtain a striclty monotone sequence as we would have with binary vectors
-            sum += curr;
-        }
-
-        // Partition elements into buckets accordingly to their less significant bits
-        for (auto x : input_entries) {
-            uint64_t bucket = get_bucket_id(x);
-            uint64_t permuted_item = perm_b_k::mi_permute[t_id](x);
-            //fake_entries[prefix_sums[bucket]-bucket]   = permuted_item;
-            //m_mid_entries[prefix_sums[bucket]-bucket]  = (permuted_item>>mid_shift) & mid_mask; // -bucket is because we have a striclty monotone sequence 
-            mid_entries_trait<mid_bits>::assign(m_mid_entries, prefix_sums[bucket]-bucket, (permuted_item>>mid_shift) & mid_mask); 
-            m_low_entries[prefix_sums[bucket]-bucket] = (permuted_item & low_mask);
-            prefix_sums[bucket]++;
-        }
     }
 };
 
@@ -265,7 +332,7 @@ template<uint8_t t_b=4,
        uint8_t t_k=3,
        uint8_t t_id=0, // id of the permutation managed by this instance
        typename perm_b_k=perm<t_b,t_b-t_k>,
-       typename t_bv=sdsl::bit_vector,
+       typename t_bv=mappable_bit_vector,
        typename t_sel=typename t_bv::select_1_type,
        bool use_simd=false> 
 class _simple_buckets_binvector_split : public _simple_buckets_binvector_split_common<t_b, t_k, t_id, perm_b_k, t_bv, t_sel, use_simd>{
@@ -274,7 +341,7 @@ class _simple_buckets_binvector_split : public _simple_buckets_binvector_split_c
 };
 
 
-template<typename t_bv=sdsl::bit_vector,
+template<typename t_bv=mappable_bit_vector,
         bool use_simd=false,
        typename t_sel=typename t_bv::select_1_type> 
 struct simple_buckets_binvector_split {
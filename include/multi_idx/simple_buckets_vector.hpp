@@ -9,6 +9,9 @@
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
 #include "multi_idx/multi_idx_helper.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
 
 namespace multi_index {
  
@@ -29,29 +32,38 @@ namespace multi_index {
         static constexpr uint8_t init_splitter_bits(size_t i=0){
             return i < perm_b_k::match_len ? perm_b_k::mi_permute_block_widths[t_id][t_b-1-i] + init_splitter_bits(i+1) : 0;
         }
+    public:
         static constexpr uint8_t    splitter_bits = init_splitter_bits(0);
 
+    private:
         uint64_t              m_n;      // number of items
-        sdsl::int_vector<64>  m_entries;
-        sdsl::int_vector<64>  m_prefix_sums;
+        mappable_int_vector<64> m_entries;
+        mappable_int_vector<64> m_prefix_sums;
+        payload_vector          m_payloads; // payloads in the order of the entries
 
     public:
 
         _simple_buckets_vector() = default;
 
-        _simple_buckets_vector(const std::vector<entry_type> &input_entries) {
+        _simple_buckets_vector(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+            _simple_buckets_vector(key_source(input_entries, payloads), pool) {}
+
+        //! Builds the index from keys in memory or streamed from a file
+        _simple_buckets_vector(const key_source &input_entries, thread_pool* pool=nullptr) {
             std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl; 
     
             m_n = input_entries.size();
 //            check_permutation<_simple_buckets_vector, t_id>(input_entries);
             m_entries = sdsl::int_vector<64>(input_entries.size(), 0);
             
-            build_small_universe(input_entries);
+            m_payloads = payload_vector(input_entries);
+            
+            build_small_universe(input_entries, pool);
         }
 
         // k with passed to match function
         // assert(k<=t_k)
-        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false) {
+        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
             uint64_t bucket = get_bucket_id(q);
     
             /* DEBUG
@@ -69,31 +81,113 @@ namespace multi_index {
             std::cout << std::endl;
                 
             std::cout << " q " <<  std::bitset<64>(q) <<std::endl;
-            std::cout << "rq " << std::bitset<64>(m_perm.mi_permute[t_id](q)) <<std::endl;
+            std::cout << "rq " << std::bitset<64>(perm_b_k::template permute<t_id>(q)) <<std::endl;
             std::cout << "bq " << std::bitset<64>(bucket) <<std::endl;
             std::cout << "---------------------\n";
             */
             
             const auto l = m_prefix_sums[(bucket)] - bucket; 
             const auto r = m_prefix_sums[bucket+1] - (bucket+1) + 1;  
-             
-            auto begin = m_entries.begin() + l;
-            auto end = m_entries.begin() + r;
     
-            uint64_t candidates = std::distance(begin,end);
+            uint64_t candidates = r-l;
             std::vector<entry_type> res;
             
             if(find_only_candidates) return {res, candidates};
+            scan(q, errors, l, r, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
+            return {res, candidates};
+        }
+
+        /*! Calls report(x, i) for all entries x within distance errors of q in the
+         *  bucket of q, where i is the position of x in the entry arrays. Stops
+         *  as soon as report returns false. Entries are reported as they are
+         *  stored, i.e. without applying the reverse permutation (see get_key).
+         *  \return The number of candidates like match.
+         */
+        template<typename t_report>
+        uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto l = m_prefix_sums[(bucket)] - bucket; 
+            const auto r = m_prefix_sums[bucket+1] - (bucket+1) + 1;  
+            scan(q, errors, l, r, report);
+            return r-l;
+        }
+
+        /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+         *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+         *  with radius - popcount(masks[j]) errors. The prefix sums are a plain
+         *  array, so the sub-queries are simply visited one after another.
+         *  Stops as soon as report returns false.
+         *  \return The number of candidates of all sub-queries.
+         */
+        template<typename t_report>
+        uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+            uint64_t candidates = 0;
+            bool go_on = true;
+            for (size_t j = 0; j < n and go_on; ++j) {
+                const uint64_t q = perm_b_k::template rev_permute<t_id>(q_permuted ^ masks[j]);
+                candidates += visit(q, radius - sdsl::bits::cnt(masks[j]), [&](uint64_t x, uint64_t i) { return go_on = report(x, i, j); });
+            }
+            return candidates;
+        }
+
+        /*! Calls report(x, i) like visit for all entries, e.g. for a linear
+         *  scan. Stops as soon as report returns false.
+         */
+        template<typename t_report>
+        void visit_all(t_report&& report) const {
+            scan(0, 64, 0, m_n, report);
+        }
+
+        //! Key of an entry x reported by visit
+        static uint64_t get_key(const uint64_t x) {
+            return x;
+        }
+
+        //! Key of an entry x reported by visit under the permutation of this index
+        static uint64_t get_permuted_key(const uint64_t x) {
+            return perm_b_k::template permute<t_id>(x);
+        }
+
+        //! Matches a batch of (sub-)queries which is sorted by bucket
+        template<typename t_sink>
+        void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            while ( first != last ) {
+                const uint64_t bucket = first->bucket;
+                const auto l = m_prefix_sums[(bucket)] - bucket; 
+                const auto r = m_prefix_sums[bucket+1] - (bucket+1) + 1;  
+                for (; first != last and first->bucket == bucket; ++first) {
+                    const uint32_t qid = first->id;
+                    sink.add_candidates(qid, r-l);
+                    if ( !find_only_candidates ) {
+                        scan(first->key, first->errors, l, r, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; });
+                    }
+                }
+            }
+        }
+
+    private:
+        // Scans the entries in [l, r) and reports all keys within distance errors of q
+        // as report(entry, position of the entry in the entry arrays), see get_key.
+        // Stops as soon as report returns false.
+        template<typename t_report>
+        inline void scan(const entry_type q, uint8_t errors, const uint64_t l, const uint64_t r, t_report&& report) const {
+            auto begin = m_entries.begin() + l;
+            auto end = m_entries.begin() + r;
+            scan_stats stats(r-l);
             for (auto it = begin; it != end; ++it) {
-               if (sdsl::bits::cnt(q^*it) <= errors)
-                 res.push_back(*it);
+               if (sdsl::bits::cnt(q^*it) <= errors) {
+                 stats.verified();
+                 if ( !report(*it, it - m_entries.begin()) ) return;
+               }
             }
-            return {res, candidates};
         }
+
+    public:
   
         _simple_buckets_vector& operator=(const _simple_buckets_vector& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_entries   = std::move(idx.m_entries);
                 m_prefix_sums = std::move(idx.m_prefix_sums);
             }
@@ -103,6 +197,7 @@ namespace multi_index {
         _simple_buckets_vector& operator=(_simple_buckets_vector&& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_entries   = std::move(idx.m_entries);
                 m_prefix_sums  = std::move(idx.m_prefix_sums);
             }
@@ -125,6 +220,7 @@ namespace multi_index {
             written_bytes += write_member(m_n, out, child, "n");
             written_bytes += m_entries.serialize(out, child, "entries"); 
             written_bytes += m_prefix_sums.serialize(out, child, "prefix_sums");   
+            written_bytes += m_payloads.serialize(out, child, "payloads");
             structure_tree::add_size(child, written_bytes);
             return written_bytes;
         }
@@ -135,30 +231,37 @@ namespace multi_index {
             read_member(m_n, in);
             m_entries.load(in);
             m_prefix_sums.load(in);
+            m_payloads.load(in);
         }
 
         size_type size() const{
             return m_n;
         }
 
-private:
+        //! True if the entries and the prefix sums live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            return m_entries.is_mapped() and m_prefix_sums.is_mapped();
+        }
 
     inline uint64_t get_bucket_id(const uint64_t x) const {
-        return perm_b_k::mi_permute[t_id](x) >> (64-splitter_bits); // take the most significant bits
+        return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits); // take the most significant bits
     }
 
-    void build_small_universe(const std::vector<entry_type> &input_entries) {
+private:
+
+    void build_small_universe(const key_source &input_entries, thread_pool* pool) {
         // Implement a countingSort-like strategy to order entries accordingly to
         // their splitter_bits MOST significant bits
         // Ranges of keys having the same MSB are not sorted. 
         uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
 
-        std::vector<uint64_t> prefix_sums(splitter_universe + 1, 0); // includes a sentinel
+        std::vector<uint64_t> prefix_sums = bucket_scatter(input_entries, splitter_universe,
+            [&](uint64_t x) { return get_bucket_id(x); },
+            [&](uint64_t j, uint64_t x, uint64_t payload) {
+                m_entries[j] = x;
+                if ( !m_payloads.empty() ) m_payloads.set(j, payload);
+            }, pool); // includes a sentinel
         m_prefix_sums = sdsl::int_vector<64>(prefix_sums.size(), 0);
-        
-        for (auto x: input_entries) {
-            prefix_sums[get_bucket_id(x)]++;
-        }
 
         uint64_t sum = prefix_sums[0];
         prefix_sums[0] = 0;
@@ -169,13 +272,6 @@ private:
             m_prefix_sums[i] = prefix_sums[i];
             sum += curr;
         }
-
-        // Partition elements into buckets accordingly to their less significant bits
-        for (auto x : input_entries) {
-            uint64_t bucket = get_bucket_id(x);
-            m_entries[prefix_sums[bucket]-bucket] = x; // -bucket is because we have a striclty monotone sequence 
-            prefix_sums[bucket]++;
-        }
     }
 };
 
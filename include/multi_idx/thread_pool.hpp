@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace multi_index {
+
+/*! Fixed-size thread pool with work stealing.
+ *
+ *  The pool has size() slots. Slots 0..size()-2 are served by worker
+ *  threads, the last slot is shared by all external threads which call
+ *  parallel_for. Every slot owns a task deque: a worker pops tasks from
+ *  the back of its own deque and steals from the front of the other
+ *  deques once it runs out of work.
+ *
+ *  A thread waiting for a parallel_for to complete executes pending tasks
+ *  in the meantime. Therefore parallel_for can also be called from inside
+ *  a task of the same pool without dead-locking. An external thread only
+ *  executes the chunks of its own parallel_for, so that no two threads
+ *  run tasks under the same slot at the same time, even if several
+ *  request threads share the pool.
+ *
+ *  If f throws, the remaining chunks of the parallel_for are skipped and
+ *  the first exception is rethrown to its caller.
+ */
+class thread_pool {
+    public:
+        //! A task gets the slot of the thread which executes it
+        typedef std::function<void(size_t)> task_type;
+
+    private:
+        // State of one parallel_for call
+        struct call_state {
+            std::atomic<size_t> remaining;
+            std::atomic<bool>   failed{false};
+            std::exception_ptr  error; // first exception of a chunk
+
+            explicit call_state(size_t chunks) : remaining(chunks) {}
+        };
+
+        struct task_entry {
+            task_type         run;
+            const call_state* call;
+        };
+
+        struct task_queue {
+            std::mutex              mtx;
+            std::deque<task_entry>  tasks;
+        };
+
+        std::vector<std::unique_ptr<task_queue>> m_queues;
+        std::vector<std::thread>                 m_threads;
+        std::atomic<size_t>                      m_queued{0};
+        bool                                     m_stop = false;
+        std::mutex                               m_sleep_mtx;
+        std::condition_variable                  m_sleep_cv;
+
+        static const thread_pool*& tl_pool() {
+            static thread_local const thread_pool* pool = nullptr;
+            return pool;
+        }
+
+        static size_t& tl_slot() {
+            static thread_local size_t slot = 0;
+            return slot;
+        }
+
+    public:
+        /*!
+         *  \param threads Number of threads including the calling thread.
+         *                 0 selects the number of hardware threads.
+         */
+        explicit thread_pool(size_t threads=0) {
+            if ( threads == 0 ) {
+                threads = std::max(1U, std::thread::hardware_concurrency());
+            }
+            for (size_t i=0; i < threads; ++i) {
+                m_queues.emplace_back(new task_queue());
+            }
+            for (size_t i=0; i+1 < threads; ++i) {
+                m_threads.emplace_back([this, i](){ worker_loop(i); });
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lk(m_sleep_mtx);
+                m_stop = true;
+            }
+            m_sleep_cv.notify_all();
+            for (auto& t : m_threads) {
+                t.join();
+            }
+        }
+
+        //! Number of slots (= threads including the external one)
+        size_t size() const {
+            return m_queues.size();
+        }
+
+        //! Slot of the calling thread
+        size_t slot() const {
+            return tl_pool() == this ? tl_slot() : size()-1;
+        }
+
+        /*! Calls f(begin, end, slot) for consecutive chunks of [0, n) of at
+         *  most grain elements and returns after all chunks are processed.
+         */
+        template<typename t_f>
+        void parallel_for(size_t n, size_t grain, t_f&& f) {
+            if ( n == 0 ) return;
+            grain = std::max((size_t)1, grain);
+            const size_t chunks = (n+grain-1)/grain;
+            const size_t my_slot = slot();
+            if ( size() == 1 or chunks == 1 ) {
+                f(0, n, my_slot);
+                return;
+            }
+            const bool external = tl_pool() != this;
+            call_state call(chunks);
+            {
+                auto& q = *m_queues[my_slot];
+                std::lock_guard<std::mutex> lk(q.mtx);
+                // Push in reverse order; the owner pops from the back and
+                // therefore processes the chunks front to back
+                for (size_t c = chunks; c-- > 0; ) {
+                    q.tasks.push_back({[&f, &call, c, grain, n](size_t s){
+                        // the chunk counts as done even if f throws
+                        struct done_guard {
+                            call_state& call;
+                            ~done_guard() { call.remaining.fetch_sub(1, std::memory_order_release); }
+                        } guard{call};
+                        if ( call.failed.load(std::memory_order_relaxed) ) return;
+                        try {
+                            f(c*grain, std::min(n, (c+1)*grain), s);
+                        } catch (...) {
+                            if ( !call.failed.exchange(true) ) call.error = std::current_exception();
+                        }
+                    }, &call});
+                }
+            }
+            m_queued.fetch_add(chunks);
+            {
+                std::lock_guard<std::mutex> lk(m_sleep_mtx);
+            }
+            m_sleep_cv.notify_all();
+
+            while ( call.remaining.load(std::memory_order_acquire) > 0 ) {
+                if ( !(external ? run_own(my_slot, &call) : run_one(my_slot)) ) {
+                    std::this_thread::yield();
+                }
+            }
+            if ( call.error ) std::rethrow_exception(call.error);
+        }
+
+    private:
+        bool pop(size_t s, task_type& task, bool back) {
+            auto& q = *m_queues[s];
+            std::lock_guard<std::mutex> lk(q.mtx);
+            if ( q.tasks.empty() ) return false;
+            if ( back ) {
+                task = std::move(q.tasks.back().run);
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front().run);
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+
+        // Executes the last queued task of call in the deque of slot s (the external one)
+        bool run_own(size_t s, const call_state* call) {
+            task_type task;
+            {
+                auto& q = *m_queues[s];
+                std::lock_guard<std::mutex> lk(q.mtx);
+                auto it = q.tasks.end();
+                while ( it != q.tasks.begin() and (it-1)->call != call ) --it;
+                if ( it == q.tasks.begin() ) return false;
+                task = std::move((it-1)->run);
+                q.tasks.erase(it-1);
+            }
+            m_queued.fetch_sub(1);
+            task(s);
+            return true;
+        }
+
+        // Executes one task of the own deque or a stolen one
+        bool run_one(size_t s) {
+            task_type task;
+            bool found = pop(s, task, true);
+            for (size_t i=1; !found and i < size(); ++i) {
+                found = pop((s+i) % size(), task, false);
+            }
+            if ( !found ) return false;
+            m_queued.fetch_sub(1);
+            task(s);
+            return true;
+        }
+
+        void worker_loop(size_t s) {
+            tl_pool() = this;
+            tl_slot() = s;
+            while ( true ) {
+                if ( run_one(s) ) continue;
+                std::unique_lock<std::mutex> lk(m_sleep_mtx);
+                m_sleep_cv.wait(lk, [this](){ return m_stop or m_queued.load() > 0; });
+                if ( m_stop and m_queued.load() == 0 ) return;
+            }
+        }
+};
+
+}
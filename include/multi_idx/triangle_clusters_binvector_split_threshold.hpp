@@ -10,7 +10,12 @@
 #include "sdsl/int_vector.hpp"
 #include "sdsl/sd_vector.hpp"
 #include "sdsl/bit_vectors.hpp"
-#include "simd_utils.hpp"
+#include "multi_idx/mappable_bit_vector.hpp"
+#include "multi_idx/bucket_sort.hpp"
+#include "multi_idx/result_sink.hpp"
+#include "multi_idx/query_counters.hpp"
+#include "multi_idx/mmap_io.hpp"
+#include "multi_idx/scan_kernels.hpp"
 
 namespace multi_index {
   
@@ -19,7 +24,7 @@ namespace multi_index {
            size_t t_id=0,
            typename perm_b_k=perm<t_b,t_b-t_k>,
            uint8_t cluster_size_threshold=50,
-           typename t_bv=sdsl::bit_vector,
+           typename t_bv=mappable_bit_vector,
            typename t_sel=typename t_bv::select_1_type,
            bool use_simd=true> 
   class _triangle_clusters_binvector_split_threshold {
@@ -40,7 +45,9 @@ namespace multi_index {
         /* Low_* stuff control how many of the less signifigant bits form the lower part */
         static constexpr uint8_t    low_bits    = 32; // PLS, keep this a power of 2, better if word aligned
         static constexpr uint64_t   low_mask    = (1ULL<<low_bits)-1;
+    public:
         static constexpr uint8_t    splitter_bits = init_splitter_bits(0);
+    private:
         static constexpr uint8_t    mid_bits = 64 - (low_bits + splitter_bits);
         static constexpr uint8_t    mid_shift   = low_bits; 
         static constexpr uint64_t   mid_mask = (1ULL<<mid_bits)-1;
@@ -48,70 +55,150 @@ namespace multi_index {
         using  mid_entries_type = typename mid_entries_trait<mid_bits>::type; 
 
         uint64_t                    m_n;      // number of items
-        sdsl::int_vector<64>        m_first_level;
-        sdsl::int_vector<low_bits>  m_low_entries;
+        mappable_int_vector<64>     m_first_level;
+        mappable_int_vector<low_bits> m_low_entries;
         mid_entries_type            m_mid_entries; 
         t_bv                        m_C;     // bit vector for prefix sums of meta-symbols
         t_sel                       m_C_sel; // select1 structure for m_C
+        payload_vector              m_payloads; // payloads in the order of the entries
 
     public:
         _triangle_clusters_binvector_split_threshold() = default;
 
-        _triangle_clusters_binvector_split_threshold(const std::vector<entry_type> &input_entries) {
+        _triangle_clusters_binvector_split_threshold(const std::vector<entry_type> &input_entries, const std::vector<uint64_t> &payloads={}, thread_pool* pool=nullptr) :
+            _triangle_clusters_binvector_split_threshold(key_source(input_entries, payloads), pool) {}
+
+        //! Builds the index from keys in memory or streamed from a file
+        _triangle_clusters_binvector_split_threshold(const key_source &input_entries, thread_pool* pool=nullptr) {
             std::cout << "Splitter bits " << (uint16_t) splitter_bits << std::endl; 
             m_n = input_entries.size();
             m_low_entries = sdsl::int_vector<low_bits>(input_entries.size(), 0); 
             m_mid_entries = mid_entries_trait<mid_bits>::get_instance(input_entries.size(), 0);
-            build_small_universe(input_entries);
+            m_payloads = payload_vector(input_entries);
+            build_small_universe(input_entries, pool);
         }
 
-        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false) const {
+        inline std::pair<std::vector<uint64_t>, uint64_t> match(const entry_type q, uint8_t errors=t_k, const bool find_only_candidates=false, const bool report_payloads=false) const {
           
             const uint64_t bucket = get_bucket_id(q);
             
-            const auto l = bucket == 0 ? 0 : m_C_sel(bucket) - bucket +1; 
-            const auto r = m_C_sel(bucket+1) - (bucket+1) + 1;  
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
     
            // std::cout << bucket << " - " << l << std::endl;
     
-            uint64_t candidates = r-l;
             std::vector<entry_type> res;
             
-            if(find_only_candidates) return {res, candidates};
+            if(find_only_candidates) return {res, r-l};
             
             if(errors >= 6) res.reserve(128);
-  
-            const uint64_t q_permuted   = perm_b_k::mi_permute[t_id](q); 
+
+            const uint64_t candidates = scan(q, errors, l, r, [&](uint64_t x, uint64_t i) { res.push_back(report_payloads ? m_payloads[i] : get_key(x)); return true; });
+            return {res, candidates};
+        }
+
+        /*! Calls report(x, i) for all entries x within distance errors of q in the
+         *  bucket of q, where i is the position of x in the entry arrays. Stops
+         *  as soon as report returns false. Entries are reported as they are
+         *  stored, i.e. without applying the reverse permutation (see get_key).
+         *  \return The number of candidates like match.
+         */
+        template<typename t_report>
+        uint64_t visit(const entry_type q, uint8_t errors, t_report&& report) const {
+            const uint64_t bucket = get_bucket_id(q);
+            const auto range = bucket_range(m_C, m_C_sel, bucket);
+            const auto l = range.first;
+            const auto r = range.second;
+            return scan(q, errors, l, r, report);
+        }
+
+        /*! Calls report(x, i, j) like visit for the matches of the sub-queries
+         *  j < n of multi_idx_red, i.e. of the key rev_permute(q_permuted ^ masks[j])
+         *  with radius - popcount(masks[j]) errors. The bucket ranges of a chunk
+         *  of sub-queries are located together, see visit_bucket_masks.
+         *  Stops as soon as report returns false.
+         *  \return The number of candidates of all sub-queries.
+         */
+        template<typename t_report>
+        uint64_t visit_masks(const uint64_t q_permuted, const uint64_t* masks, const size_t n, const uint8_t radius, t_report&& report) const {
+            return visit_bucket_masks(m_C, m_C_sel, q_permuted, masks, n, radius,
+                [](uint64_t x) { return perm_b_k::template rev_permute<t_id>(x); },
+                [&](uint64_t q) { return get_bucket_id(q); },
+                [&](uint64_t q, uint8_t errors, uint64_t, uint64_t l, uint64_t r, auto&& rep) { return scan(q, errors, l, r, rep); },
+                report);
+        }
+
+        /*! Calls report(x, i) like visit for all entries, bucket by bucket, e.g.
+         *  for a linear scan. Stops as soon as report returns false.
+         */
+        template<typename t_report>
+        void visit_all(t_report&& report) const {
+            bool go_on = true;
+            for_each_bucket(m_C, m_C_sel, 1ULL << splitter_bits, [&](uint64_t bucket, uint64_t l, uint64_t r) {
+                const uint64_t q = perm_b_k::template rev_permute<t_id>(bucket << (64-splitter_bits));
+                scan(q, 64, l, r, [&](uint64_t x, uint64_t i) { return go_on = report(x, i); });
+                return go_on;
+            });
+        }
+
+        //! Key of an entry x reported by visit
+        static uint64_t get_key(const uint64_t x) {
+            return perm_b_k::template rev_permute<t_id>(x);
+        }
+
+        //! Key of an entry x reported by visit under the permutation of this index
+        static uint64_t get_permuted_key(const uint64_t x) {
+            return x;
+        }
+
+        //! Matches a batch of (sub-)queries which is sorted by bucket
+        template<typename t_sink>
+        void match_batch(const batch_query* first, const batch_query* last, t_sink& sink, const bool find_only_candidates=false, const bool report_payloads=false) const {
+            while ( first != last ) {
+                const uint64_t bucket = first->bucket;
+                const auto range = bucket_range(m_C, m_C_sel, bucket);
+                const auto l = range.first;
+                const auto r = range.second;
+                for (; first != last and first->bucket == bucket; ++first) {
+                    const uint32_t qid = first->id;
+                    if ( find_only_candidates ) {
+                        sink.add_candidates(qid, r-l);
+                    } else {
+                        sink.add_candidates(qid, scan(first->key, first->errors, l, r, [&, qid](uint64_t x, uint64_t i) { sink.add(qid, report_payloads ? m_payloads[i] : get_key(x)); return true; }));
+                    }
+                }
+            }
+        }
+
+    private:
+        // Scans the clusters in [l, r) and reports all keys within distance errors of q
+        // as report(entry, position of the entry in the entry arrays), see get_key.
+        // Stops as soon as report returns false.
+        // Returns the number of checked candidates.
+        template<typename t_report>
+        inline uint64_t scan(const entry_type q, uint8_t errors, const uint64_t l, const uint64_t r, t_report&& report) const {
+            const uint64_t q_permuted   = perm_b_k::template permute<t_id>(q); 
             const uint64_t q_high       = (q_permuted>>(high_shift))<<high_shift;
             const uint64_t q_low        = q_permuted & low_mask;
             const uint64_t q_mid        = (q_permuted >> mid_shift) & mid_mask; // 0|0|0|B
             const uint64_t q_xor        = q_low^q_mid;
-            candidates = 0;
+            uint64_t candidates = 0;
             
             const auto fl_begin  = m_first_level.begin() + 3*l;
             const auto fl_end    = m_first_level.begin() + 3*r; 
-
-#ifdef STATS
-            stat_counter["cum_clusters"] += (r-l);
-            ++stat_counter["cum_sub_queries"];
-#endif
+            scan_stats stats(0);
             
             for(auto fl_it = fl_begin; fl_it < fl_end; fl_it+=3) {
 
               const uint64_t pivot = *(fl_it+1);
               const uint64_t error = *(fl_it+2);
               const uint64_t dist = sdsl::bits::cnt(pivot^q_permuted);
- #ifdef STATS
-            ++stat_counter["cum_clusters_checked"];
-#endif                        
               if (dist <= error+errors) {
                 uint64_t pos_l = *fl_it;
                 const uint64_t pos_r = *(fl_it+3);
-                
-#ifdef STATS
-            ++stat_counter["cum_clusters_visited"];
-            stat_counter["cum_cluster_sizes"] +=  (pos_r-pos_l);
-#endif  
+                stats.cluster_visited();
+                stats.candidates(pos_r-pos_l);
                 const auto begin  = m_low_entries.begin() + pos_l;
                 const auto end    = m_low_entries.begin() + pos_r;
 
@@ -121,82 +208,51 @@ namespace multi_index {
                 candidates += pos_r-pos_l;
 
                 if ( use_simd ) {
-                    auto it = begin;
-                    for (; ((size_t)it)%16 != 0 and it != end; ++it, ++pos_l) {
-                      const uint32_t item_xor = ((uint64_t) *it);
-                      if UNLIKELY(_mm_popcnt_u32(q_xor^item_xor) <= errors) {
-                        const uint64_t item_mid = m_mid_entries[pos_l]; 
-                        const uint64_t item_low = item_xor^item_mid; 
-                        const uint64_t curr_el = q_high | (item_mid << mid_shift) | item_low;
-                        if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                          res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
+                    const bool completed = filter_low_entries(begin, end-begin, q_xor, errors, [&](size_t i) {
+                      stats.prefiltered();
+                      const uint64_t item_mid = m_mid_entries[pos_l+i];
+                      const uint64_t item_low = begin[i]^item_mid;
+                      const uint64_t curr_el = q_high | (item_mid << mid_shift) | item_low;
+                      if (sdsl::bits::cnt(q_permuted^curr_el) <= errors) {
+                        stats.verified();
+                        return report(curr_el, pos_l+i);
                       }
-                    }
-
-                    const __m128i query = _mm_set1_epi32(q_xor);
-                    const __m128i tk    = _mm_set1_epi32(errors+1);
-
-                    for(; it < end-4; it+=4, pos_l+=4) {
-                      _mm_prefetch((const char *) (it+4), _MM_HINT_T0);
-                      const __m128i vec     = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(it)), query); // need to be aligned!
-                      const __m128i popcounts = popcount_epi32(vec); // not an intrinsics, see simd_utils.hpp
-
-                      uint16_t mask = (_mm_movemask_epi8(_mm_cmpgt_epi32(tk, popcounts))) & 0x1111;
-
-                      while(UNLIKELY(mask)) {
-                        size_t i =  (__builtin_ffs(mask))-1;
-                        mask = mask ^ (1 << i);
-                        i = i/4;
-                        const uint64_t item_mid = m_mid_entries[pos_l+i]; 
-                        const uint64_t item_low = it[i]^item_mid; 
-                        const uint64_t curr_el = q_high | (item_mid << mid_shift) | item_low;
-                        if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                          res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
-                      }
-                    }
-
-                    for (; it != end; ++it, ++pos_l) {
-                      const uint32_t item_xor = ((uint64_t) *it);
-                      if UNLIKELY(_mm_popcnt_u32(q_xor^item_xor) <= errors) {
-                        const uint64_t item_mid = m_mid_entries[pos_l]; 
-                        const uint64_t item_low = item_xor^item_mid; 
-                        const uint64_t curr_el = q_high | (item_mid << mid_shift) | item_low;
-                        if (_mm_popcnt_u64(q_permuted^curr_el) <= errors)
-                          res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
-                      }
-                    }
+                      return true;
+                    });
+                    if ( !completed ) return candidates;
                 }
                 else { 
                     for (auto it = begin; it != end; ++it, ++pos_l) {
                       const uint64_t item_xor = ((uint64_t) *it);
                       if (sdsl::bits::cnt(q_xor^item_xor) <= errors) {
-#ifdef STATS
-            ++stat_counter["cum_cluster_survivors"];
-#endif
+                         stats.prefiltered();
 
                          const uint64_t item_mid = m_mid_entries[pos_l]; 
                          const uint64_t item_low = item_xor^item_mid; 
                          const uint64_t curr_el = q_high | (item_mid << mid_shift) | item_low;
                          if (sdsl::bits::cnt(q_permuted^curr_el) <= errors) {
-                           res.push_back(perm_b_k::mi_rev_permute[t_id](curr_el));
+                           stats.verified();
+                           if ( !report(curr_el, pos_l) ) return candidates;
                          }
                        }
                      }
                 }
                 if(error >= errors and dist <= error-errors) {
-#ifdef STATS
-            ++stat_counter["early_exits"];
-#endif
+                    stats.early_exit();
                     break;
                 }
+             } else {
+                stats.cluster_skipped();
              }
             }
-            return {res, candidates};
+            return candidates;
         }
-  
+
+    public:
         _triangle_clusters_binvector_split_threshold& operator=(const _triangle_clusters_binvector_split_threshold& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_low_entries   = std::move(idx.m_low_entries);
                 m_mid_entries   = std::move(idx.m_mid_entries);
                 m_first_level   = std::move(idx.m_first_level);
@@ -211,6 +267,7 @@ namespace multi_index {
         _triangle_clusters_binvector_split_threshold& operator=(_triangle_clusters_binvector_split_threshold&& idx) {
             if ( this != &idx ) {
                 m_n       = std::move(idx.m_n);
+                m_payloads    = std::move(idx.m_payloads);
                 m_low_entries   = std::move(idx.m_low_entries);
                 m_mid_entries   = std::move(idx.m_mid_entries);
                 m_first_level   = std::move(idx.m_first_level);                               
@@ -241,6 +298,7 @@ namespace multi_index {
             written_bytes += m_C.serialize(out, child, "C");
             written_bytes += m_C_sel.serialize(out, child, "C_sel");  
             //written_bytes += fake_entries.serialize(out, child, "fake");  
+            written_bytes += m_payloads.serialize(out, child, "payloads");
             structure_tree::add_size(child, written_bytes);
             return written_bytes;
         }
@@ -254,6 +312,7 @@ namespace multi_index {
             m_first_level.load(in);
             m_C.load(in);
             m_C_sel.load(in, &m_C);
+            m_payloads.load(in);
             //fake_entries.load(in);
         }
 
@@ -261,11 +320,18 @@ namespace multi_index {
             return m_n;
         }
 
-private:
+        //! True if the entries and the bucket directory live in a memory mapping, see load_from_file_mapped
+        bool is_mapped() const {
+            return m_low_entries.is_mapped() and m_C.is_mapped();
+        }
+
+public:
 
     inline uint64_t get_bucket_id(const uint64_t x) const {
-        return perm_b_k::mi_permute[t_id](x) >> (64-splitter_bits);
+        return perm_b_k::template permute<t_id>(x) >> (64-splitter_bits);
     }
+
+private:
     
     template<typename It>
     uint64_t pivot_selection(It begin, It end, uint64_t n_pivot_candidates, size_t t) {
@@ -305,8 +371,10 @@ private:
           best_sum = sum;
         }
         
-        pivot_pos = rand()%length;
-        pivot = *(begin + pivot_pos);
+        if ( i+1 < n_pivot_candidates ) {
+          pivot_pos = rand()%length;
+          pivot = *(begin + pivot_pos);
+        }
       }
       
       std::iter_swap(begin, begin+best_pos);
@@ -314,46 +382,104 @@ private:
     }
     
 
-    void build_small_universe(const std::vector<entry_type> &input_entries) {
+    void build_small_universe(const key_source &input_entries, thread_pool* pool) {
         // Implement a countingSort-like strategy to order entries accordingly to
         // their splitter_bits MOST significant bits
         // Ranges of keys having the same MSB are not sorted. 
         uint64_t splitter_universe = ((uint64_t) 1) << (splitter_bits);
 
-        std::vector<uint64_t> prefix_sums(splitter_universe + 1, 0); // includes a sentinel
-        for (auto x: input_entries) {
-            prefix_sums[get_bucket_id(x)]++;
-        }
-        
-        uint64_t sum = prefix_sums[0];
-        prefix_sums[0] = 0;
-        for(uint64_t i = 1; i < prefix_sums.size(); ++i) {
-            uint64_t curr = prefix_sums[i];
-            prefix_sums[i] = sum;
-            sum += curr;
-        }
-
         std::vector<uint32_t> bucket_xor_ids(input_entries.size(), 0);
         std::vector<uint64_t> keys(input_entries.size(), 0);
+        std::vector<uint64_t> bucket_payloads(m_payloads.empty() ? 0 : input_entries.size());
         // Partition elements into buckets accordingly to their less significant bits
-        for (auto &x : input_entries) {
-            uint64_t bucket = get_bucket_id(x);
-            uint64_t permuted_item = perm_b_k::mi_permute[t_id](x);
-            bucket_xor_ids[prefix_sums[bucket]] = bucket;
-            keys[prefix_sums[bucket]] = permuted_item;
-            prefix_sums[bucket]++;
-        }
+        bucket_scatter(input_entries, splitter_universe,
+            [&](uint64_t x) { return get_bucket_id(x); },
+            [&](uint64_t j, uint64_t x, uint64_t payload) {
+                bucket_xor_ids[j] = get_bucket_id(x);
+                keys[j] = perm_b_k::template permute<t_id>(x);
+                if ( !m_payloads.empty() ) bucket_payloads[j] = payload;
+            }, pool);
+        // std::partition does not keep track of the positions
+        const std::vector<uint64_t> bucket_keys = m_payloads.empty() ? std::vector<uint64_t>() : keys;
         
         size_t binvector_size = 1ULL << splitter_bits;
         
+        // Buckets are clustered independently, so the parts are clustered in
+        // parallel and concatenated in order
+        std::vector<size_t> borders = run_borders(bucket_xor_ids, pool == nullptr ? 1 : 4*pool->size());
+        std::vector<std::vector<uint64_t>> part_fl(borders.size()-1);
+        std::vector<std::vector<uint8_t>> part_bv(borders.size()-1);
+        auto cluster_parts = [&](size_t begin, size_t end, size_t) {
+            for (size_t p = begin; p < end; ++p) {
+                cluster_buckets(keys, bucket_xor_ids, borders[p], borders[p+1], part_fl[p], part_bv[p]);
+            }
+        };
+        if ( pool != nullptr ) {
+            pool->parallel_for(part_fl.size(), 1, cluster_parts);
+        } else {
+            cluster_parts(0, part_fl.size(), 0);
+        }
+
         std::vector<uint64_t> fl;
         std::vector<uint8_t> bv;
-        bv.reserve(binvector_size);     
+        bv.reserve(binvector_size);
+        for (size_t p = 0; p < part_fl.size(); ++p) {
+            fl.insert(fl.end(), part_fl[p].begin(), part_fl[p].end());
+            bv.insert(bv.end(), part_bv[p].begin(), part_bv[p].end());
+        }
+        // close the last bucket and all empty buckets behind it
+        const uint64_t curr_bucket = bucket_xor_ids.empty() ? 0 : bucket_xor_ids.back();
+        for(size_t j = curr_bucket; j < splitter_universe; j++) {
+          bv.push_back(1);
+        }
+
+        parallel_ranges(pool, keys.size(), [&](size_t begin, size_t end) {
+            for(size_t k = begin; k < end; ++k) {
+                /*
+                Let A|B|C|D be the key.
+                Assume each metasymbol is 16 bits. A is searched with the binary vector becuase it is the prefix.
+                We compute low_xor = C|D xor B and we store low_xor in the low_entries and B in the mid_entries.
+                At query time, we scan the low_entries and, if we find an entry such that 
+                the number of errors is smaller than t_k, we access the corresponding B and
+                we reconstruct low_part = low_xor xor B, and we match.
+                */
+                const uint64_t low_item = keys[k] & low_mask; // C|D
+                const uint64_t mid_item = (keys[k] >> mid_shift) & mid_mask; // B
+                const uint64_t low_xor = (low_item^mid_item); // C|D xor B  
+                mid_entries_trait<mid_bits>::assign(m_mid_entries, k, mid_item); 
+                m_low_entries[k] = low_xor;    
+            }
+        });
+        fl.push_back(keys.size());
+        fl.push_back(keys.size()); // sentinel. We will access only pos on extreme cases.
+        
+        if ( !m_payloads.empty() ) {
+            m_payloads.assign_by_key(bucket_keys, bucket_payloads, keys);
+        }
+
+        std::cout << "FL " << fl.size() << " BV " << bv.size() << std::endl;
+        
+        m_first_level = sdsl::int_vector<64>(fl.size(),0);
+        for(size_t i = 0; i < fl.size(); ++i)
+          m_first_level[i] = fl[i];
+        m_C = t_bv(bv.size(), 0);
         
-        uint64_t prev_bucket = 0, curr_bucket = 0;
+        for(size_t i = 0; i < bv.size(); ++i)
+          m_C[i] = bv[i];
+        m_C_sel = t_sel(&m_C);
+        
+    }
+
+    /*! Clusters the buckets in keys[first, last) and appends their first
+     *  level entries and bits of m_C to fl and bv. first and last are bucket
+     *  borders; the result only depends on the keys in the range.
+     */
+    void cluster_buckets(std::vector<uint64_t>& keys, const std::vector<uint32_t>& bucket_xor_ids, size_t first, size_t last,
+                         std::vector<uint64_t>& fl, std::vector<uint8_t>& bv) {
+        uint64_t prev_bucket = 0, curr_bucket = first == 0 ? 0 : bucket_xor_ids[first-1];
 
-        size_t start = 0;
-        while(start < bucket_xor_ids.size()) {
+        size_t start = first;
+        while(start < last) {
           size_t end = start;
           prev_bucket = curr_bucket;
           curr_bucket = bucket_xor_ids[start];
@@ -361,10 +487,10 @@ private:
             bv.push_back(1);
           }
 
-          while(end < bucket_xor_ids.size() and curr_bucket == bucket_xor_ids[end]) end++;
+          while(end < last and curr_bucket == bucket_xor_ids[end]) end++;
+         
           size_t next = start;
           while (next < end) {
-            
             auto local_begin = keys.begin() + next;
             auto local_end = keys.begin() + end;
 
@@ -376,22 +502,6 @@ private:
                                       [&](const uint64_t &e) {return sdsl::bits::cnt(pivot^e) <= error;});
             start = next;
             next = std::distance(keys.begin(), it);
-            for(size_t k = start; k < next; ++k) {
-                   /*
-                   Let A|B|C|D be the key.
-                   Assume each metasymbol is 16 bits. A is searched with the binary vector becuase it is the prefix.
-                   We compute low_xor = C|D xor B and we store low_xor in the low_entries and B in the mid_entries.
-                   At query time, we scan the low_entries and, if we find an entry such that 
-                   the number of errors is smaller than t_k, we access the corresponding B and
-                   we reconstruct low_part = low_xor xor B, and we match.
-                   */
-                   const uint64_t low_item = keys[k] & low_mask; // C|D
-                   const uint64_t mid_item = (keys[k] >> mid_shift) & mid_mask; // B
-                   const uint64_t low_xor = (low_item^mid_item); // C|D xor B  
-              
-                   mid_entries_trait<mid_bits>::assign(m_mid_entries, k, mid_item); 
-                   m_low_entries[k] = low_xor;    
-            }
             
             uint64_t max_key_pos = next;
             uint8_t max = 0;
@@ -402,9 +512,11 @@ private:
                 max_key_pos = k;
               }
             }
-            uint64_t tmp = keys[next];
-            keys[next] = keys[max_key_pos];
-            keys[max_key_pos] = tmp;
+            if(next < end) {
+              uint64_t tmp = keys[next];
+              keys[next] = keys[max_key_pos];
+              keys[max_key_pos] = tmp;
+            }
             
             fl.push_back(start);
             fl.push_back(pivot);
@@ -414,28 +526,13 @@ private:
           
           start = end;
         }
-        bv.push_back(1);
-        fl.push_back(keys.size()+1);
-        fl.push_back(keys.size()+1); // sentinel. We will access only pos on extreme cases.
-        
-        std::cout << "FL " << fl.size() << " BV " << bv.size() << std::endl;
-        
-        m_first_level = sdsl::int_vector<64>(fl.size(),0);
-        for(size_t i = 0; i < fl.size(); ++i)
-          m_first_level[i] = fl[i];
-        m_C = t_bv(bv.size(), 0);
-        
-        for(size_t i = 0; i < bv.size(); ++i)
-          m_C[i] = bv[i];
-        m_C_sel = t_sel(&m_C);
-        
     }
 };
 
 
 template<uint8_t cluster_size_threshold=200,
        bool use_simd=false,
-       typename t_bv=sdsl::bit_vector,
+       typename t_bv=mappable_bit_vector,
        typename t_sel=typename t_bv::select_1_type> 
 struct triangle_clusters_binvector_split_threshold {
     template<uint8_t t_b, uint8_t t_k, size_t t_id, typename t_perm>
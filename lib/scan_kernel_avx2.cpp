@@ -0,0 +1,39 @@
+// Compiled with -mavx2 -mpopcnt (see lib/CMakeLists.txt)
+#include <immintrin.h>
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+namespace scan_kernels {
+
+size_t avx2(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out) {
+    const __m256i lookup256 = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                               0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low_mask256 = _mm256_set1_epi8(0x0f);
+    const __m256i ones8       = _mm256_set1_epi8(1);
+    const __m256i ones16      = _mm256_set1_epi16(1);
+    const __m256i query       = _mm256_set1_epi32(q);
+    const __m256i tk          = _mm256_set1_epi32(errors+1);
+    size_t m = 0, i = 0;
+    for (; i+8 <= n; i+=8) {
+        const __m256i vec = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a+i)), query);
+        const __m256i lo  = _mm256_and_si256(vec, low_mask256);
+        const __m256i hi  = _mm256_and_si256(_mm256_srli_epi16(vec, 4), low_mask256);
+        const __m256i cnt8 = _mm256_add_epi8(_mm256_shuffle_epi8(lookup256, lo), _mm256_shuffle_epi8(lookup256, hi));
+        // sum up the byte counts of each 32-bit lane
+        const __m256i popcounts = _mm256_madd_epi16(_mm256_maddubs_epi16(cnt8, ones8), ones16);
+        uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(tk, popcounts)));
+        while ( __builtin_expect(mask, 0) ) {
+            out[m++] = i + __builtin_ctz(mask);
+            mask &= mask-1;
+        }
+    }
+    for (; i < n; ++i) {
+        if ( (uint32_t)_mm_popcnt_u32(a[i]^q) <= errors ) {
+            out[m++] = i;
+        }
+    }
+    return m;
+}
+
+}
+}
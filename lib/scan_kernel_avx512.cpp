@@ -0,0 +1,37 @@
+// Compiled with -mavx512f -mavx512bw -mpopcnt (see lib/CMakeLists.txt)
+#include <immintrin.h>
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+namespace scan_kernels {
+
+size_t avx512(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out) {
+    const __m512i lookup512 = _mm512_set4_epi32(0x04030302, 0x03020201, 0x03020201, 0x02010100); // nibble popcounts
+    const __m512i low_mask512 = _mm512_set1_epi8(0x0f);
+    const __m512i ones8       = _mm512_set1_epi8(1);
+    const __m512i ones16      = _mm512_set1_epi16(1);
+    const __m512i query       = _mm512_set1_epi32(q);
+    const __m512i tk          = _mm512_set1_epi32(errors);
+    const __m512i step        = _mm512_set1_epi32(16);
+    __m512i pos = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    size_t m = 0, i = 0;
+    for (; i+16 <= n; i+=16, pos = _mm512_add_epi32(pos, step)) {
+        const __m512i vec = _mm512_xor_si512(_mm512_loadu_si512(a+i), query);
+        const __m512i lo  = _mm512_and_si512(vec, low_mask512);
+        const __m512i hi  = _mm512_and_si512(_mm512_srli_epi16(vec, 4), low_mask512);
+        const __m512i cnt8 = _mm512_add_epi8(_mm512_shuffle_epi8(lookup512, lo), _mm512_shuffle_epi8(lookup512, hi));
+        const __m512i popcounts = _mm512_madd_epi16(_mm512_maddubs_epi16(cnt8, ones8), ones16);
+        const __mmask16 mask = _mm512_cmple_epu32_mask(popcounts, tk);
+        _mm512_mask_compressstoreu_epi32(out+m, mask, pos);
+        m += _mm_popcnt_u32(mask);
+    }
+    for (; i < n; ++i) {
+        if ( (uint32_t)_mm_popcnt_u32(a[i]^q) <= errors ) {
+            out[m++] = i;
+        }
+    }
+    return m;
+}
+
+}
+}
@@ -0,0 +1,29 @@
+// Compiled with -mavx512f -mavx512vpopcntdq -mpopcnt (see lib/CMakeLists.txt)
+#include <immintrin.h>
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+namespace scan_kernels {
+
+size_t avx512_vpopcntdq(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out) {
+    const __m512i query = _mm512_set1_epi32(q);
+    const __m512i tk    = _mm512_set1_epi32(errors);
+    const __m512i step  = _mm512_set1_epi32(16);
+    __m512i pos = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    size_t m = 0, i = 0;
+    for (; i+16 <= n; i+=16, pos = _mm512_add_epi32(pos, step)) {
+        const __m512i vec = _mm512_xor_si512(_mm512_loadu_si512(a+i), query);
+        const __mmask16 mask = _mm512_cmple_epu32_mask(_mm512_popcnt_epi32(vec), tk);
+        _mm512_mask_compressstoreu_epi32(out+m, mask, pos);
+        m += _mm_popcnt_u32(mask);
+    }
+    for (; i < n; ++i) {
+        if ( (uint32_t)_mm_popcnt_u32(a[i]^q) <= errors ) {
+            out[m++] = i;
+        }
+    }
+    return m;
+}
+
+}
+}
@@ -0,0 +1,17 @@
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+namespace scan_kernels {
+
+size_t plain(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out) {
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        // branch-free, the positions are overwritten if the entry does not match
+        out[m] = i;
+        m += (uint32_t)__builtin_popcount(a[i]^q) <= errors;
+    }
+    return m;
+}
+
+}
+}
@@ -0,0 +1,30 @@
+// Compiled with -msse4.2 (see lib/CMakeLists.txt)
+#include "multi_idx/scan_kernels.hpp"
+#include "multi_idx/simd_utils.hpp"
+
+namespace multi_index {
+namespace scan_kernels {
+
+size_t sse42(const uint32_t* a, size_t n, uint32_t q, uint32_t errors, uint32_t* out) {
+    const __m128i query = _mm_set1_epi32(q);
+    const __m128i tk    = _mm_set1_epi32(errors+1);
+    size_t m = 0, i = 0;
+    for (; i+4 <= n; i+=4) {
+        const __m128i vec       = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i)), query);
+        const __m128i popcounts = popcount_epi32(vec); // not an intrinsics, see simd_utils.hpp
+        uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(tk, popcounts)));
+        while ( UNLIKELY(mask) ) {
+            out[m++] = i + __builtin_ctz(mask);
+            mask &= mask-1;
+        }
+    }
+    for (; i < n; ++i) {
+        if ( (uint32_t)_mm_popcnt_u32(a[i]^q) <= errors ) {
+            out[m++] = i;
+        }
+    }
+    return m;
+}
+
+}
+}
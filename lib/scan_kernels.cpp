@@ -0,0 +1,27 @@
+#include "multi_idx/scan_kernels.hpp"
+
+namespace multi_index {
+
+scan_kernel_info select_scan_kernel() {
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512vpopcntdq") ) {
+        return {"avx512_vpopcntdq", scan_kernels::avx512_vpopcntdq};
+    }
+    if ( __builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw") ) {
+        return {"avx512", scan_kernels::avx512};
+    }
+    if ( __builtin_cpu_supports("avx2") and __builtin_cpu_supports("popcnt") ) {
+        return {"avx2", scan_kernels::avx2};
+    }
+    if ( __builtin_cpu_supports("sse4.2") and __builtin_cpu_supports("popcnt") ) {
+        return {"sse4.2", scan_kernels::sse42};
+    }
+    return {"plain", scan_kernels::plain};
+}
+
+const scan_kernel_info& get_scan_kernel() {
+    static const scan_kernel_info info = select_scan_kernel();
+    return info;
+}
+
+}
@@ -0,0 +1,325 @@
+#include "multi_idx/index_registry.hpp"
+#include "multi_idx/query_counters.hpp"
+#include "multi_idx/scan_kernels.hpp"
+#include "multi_idx/thread_pool.hpp"
+#include <sdsl/int_vector.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace sdsl;
+using namespace multi_index;
+
+using timer = std::chrono::steady_clock;
+
+vector<uint64_t> load_keys(const string& file, bool unique)
+{
+    vector<uint64_t> keys;
+    int_vector_buffer<64> key_buf(file, ios::in, 1<<20, 64, true);
+    for (size_t i=0; i<key_buf.size(); ++i){
+        keys.push_back(key_buf[i]);
+    }
+    if ( unique ) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+    return keys;
+}
+
+struct bench_options {
+    string dataset;          // prefix of the files written by gen_bench_data
+    uint64_t k = 3;
+    string out_file;
+    string format = "json";  // csv if out_file ends with .csv
+    vector<string> strategies; // empty = all
+    size_t repetitions = 3;
+    int radius = -1;         // -1 = k
+    bool parallel = false;
+    size_t threads = 0;      // 0 = serial queries
+};
+
+// Latencies of one query set over all repetitions
+struct latency_stats {
+    vector<uint64_t> ns;
+
+    double mean_us() const {
+        uint64_t sum = 0;
+        for (auto x : ns) sum += x;
+        return ns.empty() ? 0 : sum/(1000.0*ns.size());
+    }
+
+    //! p in [0,100]; ns has to be sorted
+    double percentile_us(double p) const {
+        if ( ns.empty() ) return 0;
+        const size_t i = std::min(ns.size()-1, (size_t)(p/100*ns.size()));
+        return ns[i]/1000.0;
+    }
+};
+
+struct bench_record {
+    string   strategy;
+    uint64_t blocks = 0;
+    uint64_t threads = 1;        // threads of each query
+    double   build_ms = 0;
+    uint64_t bytes = 0;
+    string   query_set;
+    uint64_t queries = 0;
+    latency_stats latency;
+    double   queries_per_second = 0;
+    uint64_t candidates = 0;     // of one repetition
+    uint64_t unique_matches = 0; // of one repetition
+    query_counts counts;         // of one repetition
+};
+
+// Query of an index which splits its sub-queries over a pool (multi_idx_red)
+template<typename t_index>
+auto match_query(const t_index& idx, uint64_t q, vector<uint64_t>& result, int radius, thread_pool* pool, int)
+    -> decltype(idx.match(q, *pool, radius), uint64_t()) {
+    if ( pool == nullptr ) {
+        return idx.match(q, result, radius);
+    }
+    auto res = idx.match(q, *pool, radius);
+    result.insert(result.end(), res.first.begin(), res.first.end());
+    return res.second;
+}
+
+// Other indexes answer each query with one thread
+template<typename t_index>
+uint64_t match_query(const t_index& idx, uint64_t q, vector<uint64_t>& result, int radius, thread_pool*, long) {
+    return idx.match(q, result, radius);
+}
+
+template<typename t_index>
+constexpr auto has_pool_match(int) -> decltype(std::declval<const t_index&>().match(0, std::declval<thread_pool&>(), 0), bool()) {
+    return true;
+}
+
+template<typename t_index>
+constexpr bool has_pool_match(long) {
+    return false;
+}
+
+/*! Runs all queries repetitions times and measures each query on its own.
+ *  A first pass warms up the caches and is not measured. If pool is not
+ *  null, the sub-queries of each query run in parallel on it.
+ */
+template<typename t_index>
+bench_record run_queries(const t_index& idx, const string& name, const vector<uint64_t>& qry, int radius, size_t repetitions,
+                         thread_pool* pool) {
+    bench_record rec;
+    rec.query_set = name;
+    rec.queries = qry.size();
+    vector<uint64_t> result;
+    for (auto q : qry) {
+        result.clear();
+        match_query(idx, q, result, radius, pool, 0);
+    }
+    rec.latency.ns.reserve(qry.size()*repetitions);
+    double total_s = 0;
+    for (size_t r=0; r < repetitions; ++r) {
+        const query_counts before = query_counters::thread_counts();
+        uint64_t candidates = 0;
+        const auto start = timer::now();
+        for (auto q : qry) {
+            const auto q_start = timer::now();
+            result.clear();
+            candidates += match_query(idx, q, result, radius, pool, 0);
+            rec.latency.ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(timer::now()-q_start).count());
+        }
+        total_s += std::chrono::duration<double>(timer::now()-start).count();
+        if ( r == 0 ) {
+            rec.counts = query_counters::thread_counts() - before;
+            rec.candidates = candidates;
+        }
+    }
+    for (auto q : qry) {
+        rec.unique_matches += idx.count(q, radius);
+    }
+    std::sort(rec.latency.ns.begin(), rec.latency.ns.end());
+    rec.queries_per_second = total_s > 0 ? qry.size()*repetitions/total_s : 0;
+    return rec;
+}
+
+template<typename t_index>
+void bench(const registry_entry<t_index>& entry, const bench_options& opt, const vector<uint64_t>& keys,
+           const vector<pair<string, vector<uint64_t>>>& query_sets, vector<bench_record>& records,
+           vector<string>& skipped) {
+    cerr << "bench " << entry.strategy << " k=" << (size_t)entry.k << endl;
+    const auto start = timer::now();
+    t_index idx;
+    try {
+        idx = t_index(keys, opt.parallel);
+    } catch (const std::exception& e) {
+        // e.g. the bit vector of mi_bv_red is too large for few blocks
+        cerr << "ERROR: Construction of " << entry.strategy << " failed: " << e.what() << endl;
+        skipped.push_back(entry.strategy);
+        return;
+    }
+    const double build_ms = std::chrono::duration<double, std::milli>(timer::now()-start).count();
+    const uint64_t bytes = size_in_bytes(idx);
+    const int radius = opt.radius < 0 ? entry.k : opt.radius;
+    std::unique_ptr<thread_pool> pool;
+    if ( opt.threads > 0 and has_pool_match<t_index>(0) ) {
+        pool.reset(new thread_pool(opt.threads));
+    }
+    for (const auto& qs : query_sets) {
+        bench_record rec = run_queries(idx, qs.first, qs.second, radius, opt.repetitions, pool.get());
+        rec.threads = pool ? pool->size() : 1;
+        rec.strategy = entry.strategy;
+        rec.blocks = entry.blocks;
+        rec.build_ms = build_ms;
+        rec.bytes = bytes;
+        records.push_back(std::move(rec));
+    }
+}
+
+// Column names and values of a record in output order
+vector<pair<string, string>> columns(const bench_record& r) {
+    auto num = [](double x) { ostringstream s; s << std::setprecision(6) << x; return s.str(); };
+    const double q = r.queries > 0 ? r.queries : 1;
+    vector<pair<string, string>> c = {
+        {"strategy", "\"" + r.strategy + "\""},
+        {"blocks", to_string(r.blocks)},
+        {"threads", to_string(r.threads)},
+        {"build_ms", num(r.build_ms)},
+        {"bytes", to_string(r.bytes)},
+        {"query_set", "\"" + r.query_set + "\""},
+        {"queries", to_string(r.queries)},
+        {"queries_per_second", num(r.queries_per_second)},
+        {"latency_mean_us", num(r.latency.mean_us())},
+        {"latency_p50_us", num(r.latency.percentile_us(50))},
+        {"latency_p90_us", num(r.latency.percentile_us(90))},
+        {"latency_p99_us", num(r.latency.percentile_us(99))},
+        {"latency_p999_us", num(r.latency.percentile_us(99.9))},
+        {"latency_max_us", num(r.latency.percentile_us(100))},
+        {"candidates_per_query", num(r.candidates/q)},
+        {"unique_matches_per_query", num(r.unique_matches/q)},
+    };
+    for (size_t i=0; i < query_counter_slots; ++i) {
+        const query_counter s = (query_counter)i;
+        c.push_back({string(query_counts::name(s)) + "_per_query", num(r.counts[s]/q)});
+    }
+    return c;
+}
+
+void write_json(ostream& out, const bench_options& opt, uint64_t n, const vector<bench_record>& records,
+                const vector<string>& skipped) {
+    out << "{" << endl;
+    out << "  \"dataset\": \"" << opt.dataset << "\"," << endl;
+    out << "  \"keys\": " << n << "," << endl;
+    out << "  \"k\": " << opt.k << "," << endl;
+    out << "  \"radius\": " << (opt.radius < 0 ? (int)opt.k : opt.radius) << "," << endl;
+    out << "  \"repetitions\": " << opt.repetitions << "," << endl;
+    out << "  \"parallel_construction\": " << opt.parallel << "," << endl;
+    out << "  \"scan_kernel\": \"" << get_scan_kernel().name << "\"," << endl;
+    out << "  \"skipped\": [";
+    for (size_t i=0; i < skipped.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << "\"" << skipped[i] << "\"";
+    }
+    out << "]," << endl;
+    out << "  \"results\": [";
+    for (size_t i=0; i < records.size(); ++i) {
+        out << (i == 0 ? "" : ",") << endl << "    {";
+        const auto cols = columns(records[i]);
+        for (size_t j=0; j < cols.size(); ++j) {
+            out << (j == 0 ? "" : ", ") << "\"" << cols[j].first << "\": " << cols[j].second;
+        }
+        out << "}";
+    }
+    out << endl << "  ]" << endl << "}" << endl;
+}
+
+void write_csv(ostream& out, const bench_options& opt, uint64_t n, const vector<bench_record>& records) {
+    out << "dataset,keys,k";
+    if ( !records.empty() ) {
+        for (const auto& c : columns(records[0])) out << "," << c.first;
+    }
+    out << endl;
+    for (const auto& r : records) {
+        out << opt.dataset << "," << n << "," << opt.k;
+        for (const auto& c : columns(r)) {
+            string v = c.second;
+            v.erase(std::remove(v.begin(), v.end(), '"'), v.end());
+            out << "," << v;
+        }
+        out << endl;
+    }
+}
+
+int main(int argc, char* argv[]){
+    if ( argc < 4 ) {
+        cout << "Usage: " << argv[0] << " dataset k out_file [strategies] [repetitions] [radius] [parallel_construction] [threads]" << endl;
+        cout << " dataset: prefix of the files of gen_bench_data; reads dataset.data, dataset.existing.query and dataset.real.query" << endl;
+        cout << " k: benchmarks all index types of multi_idx_tool list with this k" << endl;
+        cout << " out_file: result file; CSV if it ends with .csv, JSON otherwise" << endl;
+        cout << " strategies: comma separated strategy ids or all (default)" << endl;
+        cout << " repetitions: number of measured runs of each query set (default 3)" << endl;
+        cout << " radius: search radius r <= k (default k)" << endl;
+        cout << " parallel_construction: 0=No (default); 1=Yes" << endl;
+        cout << " threads: 0=serial queries (default); t>0=run the sub-queries of each query on t threads (multi_idx_red types only)" << endl;
+        return 1;
+    }
+    bench_options opt;
+    opt.dataset = argv[1];
+    opt.k = stoull(argv[2]);
+    opt.out_file = argv[3];
+    if ( opt.out_file.size() >= 4 and opt.out_file.substr(opt.out_file.size()-4) == ".csv" ) {
+        opt.format = "csv";
+    }
+    if ( argc > 4 and string(argv[4]) != "all" ) {
+        stringstream ss(argv[4]);
+        for (string s; getline(ss, s, ','); ) opt.strategies.push_back(s);
+    }
+    if ( argc > 5 ) opt.repetitions = std::max(1ULL, stoull(argv[5]));
+    if ( argc > 6 ) opt.radius = stoi(argv[6]);
+    if ( argc > 7 ) opt.parallel = stoull(argv[7]);
+    if ( argc > 8 ) opt.threads = stoull(argv[8]);
+    if ( opt.radius > (int)opt.k ) {
+        cout << "ERROR: radius " << opt.radius << " is not in [0," << opt.k << "]." << endl;
+        return 1;
+    }
+
+    const vector<uint64_t> keys = load_keys(opt.dataset + ".data", true);
+    vector<pair<string, vector<uint64_t>>> query_sets;
+    for (string set : {"existing", "real"}) {
+        query_sets.push_back({set, load_keys(opt.dataset + "." + set + ".query", false)});
+    }
+    if ( keys.empty() or query_sets[0].second.empty() or query_sets[1].second.empty() ) {
+        cout << "ERROR: Could not load " << opt.dataset << ".data and its query files." << endl;
+        return 1;
+    }
+
+    vector<bench_record> records;
+    vector<string> skipped;
+    bool found = false;
+    for_each_index(index_registry(), [&](const auto& entry) {
+        if ( entry.k != opt.k ) return;
+        if ( !opt.strategies.empty() and
+             std::find(opt.strategies.begin(), opt.strategies.end(), entry.strategy) == opt.strategies.end() ) return;
+        found = true;
+        bench(entry, opt, keys, query_sets, records, skipped);
+    });
+    if ( !found ) {
+        cout << "ERROR: No index type with k=" << opt.k << " and the given strategies; see multi_idx_tool list." << endl;
+        return 1;
+    }
+    ofstream out(opt.out_file);
+    if ( !out ) {
+        cout << "ERROR: Could not open " << opt.out_file << "." << endl;
+        return 1;
+    }
+    if ( opt.format == "json" ) {
+        write_json(out, opt, keys.size(), records, skipped);
+    } else {
+        write_csv(out, opt, keys.size(), records);
+    }
+    cerr << "Results written to " << opt.out_file << endl;
+    return 0;
+}
@@ -32,7 +32,7 @@ template<size_t STEP>
         if(STEP == 1) {
           for (; it != end; ++it) {
             if ( sdsl::bits::cnt(*it^mask) <= 3 ) 
-              sum += perm<4,1>::mi_rev_permute[0](*it);
+              sum += perm<4,1>::rev_permute<0>(*it);
             iter += 1;
           }      
         } else {  // Skip STEP elements every STEP elements
@@ -40,7 +40,7 @@ template<size_t STEP>
             auto end2 = it + STEP;
             for (; it != end2; ++it) {
               if ( sdsl::bits::cnt(*it^mask) <= 3 ) 
-                sum += perm<4,1>::mi_rev_permute[0](*it);
+                sum += perm<4,1>::rev_permute<0>(*it);
               iter += 1;
             }
             it += STEP;
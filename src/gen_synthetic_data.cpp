@@ -0,0 +1,259 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cmath>
+#include <cstdint>
+
+using namespace std;
+
+/*! Generates synthetic hash files with controllable structure.
+ *
+ *  Output: like gen_bench_data, i.e. prefix.data (the keys),
+ *  prefix.existing.query (queries with a planted neighbour) and
+ *  prefix.real.query (queries without one).
+ *
+ *  Each key is a function of the seed and its position. So the keys are
+ *  streamed to disk and the neighbour of a query is regenerated instead of
+ *  being stored, which keeps the memory constant for billions of keys.
+ *  The data is not deduplicated, the indexes and bench_index do that.
+ */
+
+// splitmix64; counter based, so that stream(seed, i) needs no state
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Sequential random numbers of the stream of (seed, id)
+struct rng {
+    uint64_t state;
+    rng(uint64_t seed, uint64_t stream, uint64_t id) : state(mix(mix(seed ^ mix(stream)) ^ id)) {}
+    uint64_t next() { return mix(state++); }
+    double uniform() { return (next() >> 11) * (1.0 / (1ULL << 53)); }
+    uint64_t below(uint64_t n) { return (uint64_t)(uniform() * n) % n; }
+};
+
+enum : uint64_t { stream_center = 1, stream_member, stream_query, stream_miss };
+
+// Discrete distribution over distances, given as d:weight,...
+struct distance_dist {
+    vector<pair<uint8_t, double>> cdf;
+
+    static distance_dist parse(const string& s) {
+        distance_dist res;
+        double sum = 0;
+        stringstream ss(s);
+        for (string item; getline(ss, item, ','); ) {
+            const size_t p = item.find(':');
+            const unsigned long d = stoul(item.substr(0, p));
+            const double w = p == string::npos ? 1.0 : stod(item.substr(p+1));
+            if ( d > 64 or w < 0 ) throw invalid_argument("bad distance " + item);
+            sum += w;
+            res.cdf.push_back({(uint8_t)d, sum});
+        }
+        if ( sum <= 0 ) throw invalid_argument("empty distance distribution " + s);
+        for (auto& x : res.cdf) x.second /= sum;
+        return res;
+    }
+
+    uint8_t sample(rng& r) const {
+        const double u = r.uniform();
+        for (const auto& x : cdf) {
+            if ( u < x.second ) return x.first;
+        }
+        return cdf.back().first;
+    }
+
+    string str() const {
+        stringstream ss;
+        double prev = 0;
+        for (const auto& x : cdf) {
+            ss << (prev == 0 ? "" : ",") << (size_t)x.first << ":" << x.second-prev;
+            prev = x.second;
+        }
+        return ss.str();
+    }
+};
+
+struct generator {
+    uint64_t seed = 1;
+    uint64_t n = 0;
+    bool clustered = false;
+    uint64_t cluster_size = 16;
+    distance_dist radius = distance_dist::parse("1:1,2:1,3:1");
+    double bias = 0;                 // in [0, 0.5)
+    vector<uint64_t> bit_threshold;  // P[bit j = 1] * 2^32
+
+    void init() {
+        bit_threshold.resize(64);
+        for (size_t j=0; j < 64; ++j) {
+            // ramp from 0.5+bias at bit 0 to 0.5-bias at bit 63
+            const double p = 0.5 + bias * (1.0 - 2.0*j/63);
+            bit_threshold[j] = (uint64_t)(p * (1ULL << 32));
+        }
+    }
+
+    // A key of the underlying distribution (uniform or with biased bits)
+    uint64_t base_key(rng& r) const {
+        if ( bias == 0 ) return r.next();
+        uint64_t x = 0;
+        for (size_t j=0; j < 64; j += 2) {
+            const uint64_t w = r.next();
+            x |= (uint64_t)((w & 0xFFFFFFFFULL) < bit_threshold[j]) << j;
+            x |= (uint64_t)((w >> 32) < bit_threshold[j+1]) << (j+1);
+        }
+        return x;
+    }
+
+    // Flips d distinct random bits of x
+    static uint64_t flip(uint64_t x, uint8_t d, rng& r) {
+        uint64_t mask = 0;
+        while ( (uint8_t)__builtin_popcountll(mask) < d ) {
+            mask |= 1ULL << (r.next() & 63);
+        }
+        return x ^ mask;
+    }
+
+    /*! Key at position i. In the clustered model the keys i with the same
+     *  i/cluster_size form a cluster; the first is its center and the others
+     *  are at a distance drawn from the radius distribution around it.
+     */
+    uint64_t key(uint64_t i) const {
+        if ( !clustered ) {
+            rng r(seed, stream_center, i);
+            return base_key(r);
+        }
+        const uint64_t c = i / cluster_size;
+        rng rc(seed, stream_center, c);
+        const uint64_t center = base_key(rc);
+        if ( i % cluster_size == 0 ) return center;
+        rng rm(seed, stream_member, i);
+        return flip(center, radius.sample(rm), rm);
+    }
+};
+
+class key_writer {
+    private:
+        ofstream m_out;
+        vector<uint64_t> m_buf;
+    public:
+        explicit key_writer(const string& file) : m_out(file, std::ofstream::binary) {
+            m_buf.reserve(1<<20);
+        }
+        bool good() const { return m_out.good(); }
+        void push_back(uint64_t x) {
+            m_buf.push_back(x);
+            if ( m_buf.size() == m_buf.capacity() ) flush();
+        }
+        void flush() {
+            m_out.write((const char*)m_buf.data(), m_buf.size()*sizeof(uint64_t));
+            m_buf.clear();
+        }
+        ~key_writer() { flush(); }
+};
+
+int main(int argc, char* argv[]){
+    if ( argc < 3 ) {
+        cout << "Usage: ./" << argv[0] << " prefix n [option=value ...]" << endl;
+        cout << " Writes n keys to prefix.data, queries with a planted neighbour to" << endl;
+        cout << " prefix.existing.query and queries without one to prefix.real.query." << endl;
+        cout << " model=uniform|clustered   key model (default uniform)" << endl;
+        cout << " cluster_size=16           keys per cluster of the clustered model" << endl;
+        cout << " radius=1:1,2:1,3:1        distances of cluster members to their center as d:weight,..." << endl;
+        cout << " bias=0                    bit j is 1 with probability 0.5+bias*(1-2j/63), bias in [0,0.5)" << endl;
+        cout << " queries=10000             number of queries of each query file" << endl;
+        cout << " hits=0:1,1:1,2:1,3:1      distances of the existing queries to their planted key as d:weight,..." << endl;
+        cout << " seed=1                    seed; the output is a function of all options" << endl;
+        return 1;
+    }
+    const string prefix = argv[1];
+    generator gen;
+    gen.n = stoull(argv[2]);
+    uint64_t n_queries = 10000;
+    distance_dist hits = distance_dist::parse("0:1,1:1,2:1,3:1");
+    try {
+        for (int i=3; i < argc; ++i) {
+            const string arg = argv[i];
+            const size_t p = arg.find('=');
+            if ( p == string::npos ) throw invalid_argument("expected option=value, got " + arg);
+            const string key = arg.substr(0, p);
+            const string value = arg.substr(p+1);
+            if ( key == "model" ) {
+                if ( value != "uniform" and value != "clustered" ) throw invalid_argument("unknown model " + value);
+                gen.clustered = value == "clustered";
+            } else if ( key == "cluster_size" ) {
+                gen.cluster_size = stoull(value);
+            } else if ( key == "radius" ) {
+                gen.radius = distance_dist::parse(value);
+            } else if ( key == "bias" ) {
+                gen.bias = stod(value);
+            } else if ( key == "queries" ) {
+                n_queries = stoull(value);
+            } else if ( key == "hits" ) {
+                hits = distance_dist::parse(value);
+            } else if ( key == "seed" ) {
+                gen.seed = stoull(value);
+            } else {
+                throw invalid_argument("unknown option " + key);
+            }
+        }
+        if ( gen.n == 0 or gen.cluster_size == 0 ) throw invalid_argument("n and cluster_size have to be positive");
+        if ( gen.bias < 0 or gen.bias >= 0.5 ) throw invalid_argument("bias has to be in [0,0.5)");
+    } catch (const std::exception& e) {
+        cout << "ERROR: " << e.what() << "." << endl;
+        return 1;
+    }
+    gen.init();
+
+    {
+        key_writer data(prefix + ".data");
+        if ( !data.good() ) {
+            cout << "ERROR: Could not open " << prefix << ".data." << endl;
+            return 1;
+        }
+        for (uint64_t i=0; i < gen.n; ++i) {
+            data.push_back(gen.key(i));
+        }
+    }
+
+    /* Queries with a planted key at a distance drawn from hits */
+    map<uint8_t, uint64_t> hit_cnt;
+    {
+        key_writer existing(prefix + ".existing.query");
+        for (uint64_t i=0; i < n_queries; ++i) {
+            rng r(gen.seed, stream_query, i);
+            const uint64_t planted = gen.key(r.below(gen.n));
+            const uint8_t d = hits.sample(r);
+            ++hit_cnt[d];
+            existing.push_back(generator::flip(planted, d, r));
+        }
+    }
+
+    /* Queries drawn from the key model but not from the data */
+    {
+        key_writer real(prefix + ".real.query");
+        for (uint64_t i=0; i < n_queries; ++i) {
+            rng r(gen.seed, stream_miss, i);
+            real.push_back(gen.base_key(r));
+        }
+    }
+
+    cout << "# keys = " << gen.n << endl;
+    cout << "# model = " << (gen.clustered ? "clustered" : "uniform") << endl;
+    if ( gen.clustered ) {
+        cout << "# cluster_size = " << gen.cluster_size << endl;
+        cout << "# radius = " << gen.radius.str() << endl;
+    }
+    cout << "# bias = " << gen.bias << endl;
+    cout << "# seed = " << gen.seed << endl;
+    cout << "# queries = " << n_queries << endl;
+    for (const auto& x : hit_cnt) {
+        cout << "# existing_queries_at_distance_" << (size_t)x.first << " = " << x.second << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,399 @@
+#include "multi_idx/index_file.hpp"
+#include "multi_idx/query_engine.hpp"
+#include "multi_idx/scan_kernels.hpp"
+#include <sdsl/int_vector.hpp>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace sdsl;
+using namespace multi_index;
+
+using namespace std::chrono;
+using timer = std::chrono::high_resolution_clock;
+
+vector<uint64_t> unique_vec(vector<uint64_t> v){
+    if(v.size()>0){
+        std::sort(v.begin(), v.end());
+        auto end = std::unique(v.begin(), v.end());
+        v.resize(end-v.begin());
+    }
+    return v;
+}
+
+// Sorted keys of a hash file; duplicates are kept unless unique is set
+vector<uint64_t> load_keys(string hash_file, bool unique=true)
+{
+    vector<uint64_t> keys;
+    int_vector_buffer<64> key_buf(hash_file, ios::in, 1<<20, 64, true);
+    for (size_t i=0; i<key_buf.size(); ++i){
+        keys.push_back(key_buf[i]);
+    }
+    if ( !unique ) {
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    }
+    return unique_vec(keys);
+}
+
+void warmup_core_and_cache(){
+    std::vector<uint64_t> v(1ULL<<23, 0xABCDABCDABCDABCDULL); // generate 8*4M = 64 MB data
+    for(size_t i=0; i<v.size(); ++i){
+        v[i] = v[i]-7*i;
+    }
+    uint64_t cnt = 0;
+    for(size_t i=0; i<v.size()/2; ++i){
+        cnt += v[i]^v[v.size()-1-i];
+    }
+    std::cout<<"warmup "<<cnt<<std::endl;
+}
+
+struct build_options {
+    string   hash_file;
+    string   idx_file;
+    bool     async = false;
+    uint64_t budget_mb = 0;
+};
+
+struct query_options {
+    string idx_file;
+    string qry_file;
+    string hash_file;   // keys for check mode
+    bool   search_only = false;
+    bool   print_info = false;
+    bool   check_mode = false;
+    size_t threads = 0;
+    bool   mmap_load = false;
+    int    radius = -1; // -1 = k
+    bool   keep_duplicates = false; // the index was streamed, so equal keys are separate entries
+};
+
+template<typename t_index>
+int build(const registry_entry<t_index>& entry, const build_options& opt) {
+    t_index pi;
+    uint64_t n = 0;
+    auto start = timer::now();
+    if ( opt.budget_mb > 0 ) {
+        // stream the hash file instead of loading and deduplicating it
+        key_source keys(opt.hash_file, "", opt.budget_mb<<20);
+        n = keys.size();
+        start = timer::now();
+        if ( opt.async ) {
+            thread_pool pool;
+            pi = t_index(keys, pool);
+        } else {
+            pi = t_index(keys);
+        }
+    } else {
+        vector<uint64_t> keys = load_keys(opt.hash_file);
+        n = keys.size();
+        start = timer::now();
+        pi = t_index(keys, opt.async);
+    }
+    auto stop = timer::now();
+    const double secs = duration_cast<chrono::microseconds>(stop-start).count()/1e6;
+    cout << "# hash_file = " << opt.hash_file << endl;
+    cout << "# idx_file = " << opt.idx_file << endl;
+    cout << "# index = " << entry.strategy << endl;
+    cout << "# b = " << (size_t)entry.blocks << endl;
+    cout << "# k = " << (size_t)entry.k << endl;
+    cout << "# parallel_construction = " << opt.async << endl;
+    cout << "# build_budget_in_mb = " << opt.budget_mb << endl;
+    cout << "# construction_time_in_ms = " << (uint64_t)(secs*1000) << endl;
+    cout << "# construction_keys_per_second = " << (secs > 0 ? n/secs : 0) << endl;
+    index_build_params params;
+    params.parallel  = opt.async;
+    params.budget_mb = opt.budget_mb;
+    if ( !store_index(pi, entry, opt.idx_file, params) ) {
+        cout << "ERROR: Could not write index file " << opt.idx_file << "." << endl;
+        return 1;
+    }
+    write_structure<HTML_FORMAT>(pi, opt.idx_file+".html");
+    return 0;
+}
+
+// Compares the results of match_unique with a linear scan over the sorted keys
+template<typename t_index>
+int check(const t_index& pi, const vector<uint64_t>& keys, const int_vector<64>& qry, int radius) {
+    cout << "Checking results "<< endl;
+    for (size_t i=0; i<qry.size(); ++i){
+        auto res = get<0>(pi.match_unique(qry[i], radius));
+        std::sort(res.begin(), res.end()); // an entry reported twice is an error
+        vector<uint64_t> res_check;
+        for (size_t j=0; j<keys.size(); ++j){
+            if ( (int)bits::cnt(keys[j] ^ qry[i]) <= radius ) {
+                res_check.push_back(keys[j]);
+            }
+        }
+        if ( res != res_check ) {
+            cout<<"ERROR: res.size()="<<res.size()<<" res_check.size()="<<res_check.size()<<endl;
+            cout<<"key="<<bitset<64>(qry[i])<<" ("<<qry[i]<<")"<<endl;
+            size_t j0=0, j1=0;
+            while ( j0 < res.size() or j1 < res_check.size() ) {
+                if ( j0 < res.size() and j1 < res_check.size() and res[j0] == res_check[j1] ) {
+                    ++j0; ++j1;
+                } else if ( j1 == res_check.size() or (j0 < res.size() and res[j0] < res_check[j1]) ) {
+                    cout<<"res="<<bitset<64>(res[j0])<<" ("<<res[j0]<<") d="<< bits::cnt(res[j0]^qry[i]) <<endl;
+                    ++j0;
+                } else {
+                    cout<<"cck="<<bitset<64>(res_check[j1])<<" ("<<res_check[j1]<<") d="<< bits::cnt(res_check[j1]^qry[i])<<endl;
+                    ++j1;
+                }
+            }
+            return 1;
+        }
+        cout << (res.size() > 1 ? "*" : ".");
+        cout.flush();
+    }
+    cout << endl;
+    return 0;
+}
+
+// Prints the average counters of a query run, see query_counters
+void print_query_counts(const query_counts& counts, size_t queries) {
+    for (size_t i=0; i < query_counter_slots; ++i) {
+        const query_counter c = (query_counter)i;
+        cout << "# " << query_counts::name(c) << "_per_query = " << ((double)counts[c])/queries << endl;
+    }
+}
+
+template<typename t_index>
+int query(const registry_entry<t_index>& entry, const query_options& opt) {
+    const int radius = opt.radius < 0 ? entry.k : opt.radius;
+    if ( radius > entry.k ) {
+        cout << "Error: radius " << radius << " is not in [0," << (size_t)entry.k << "]." << endl;
+        return 1;
+    }
+
+    mmap_file idx_map; // has to outlive pi if the index is mapped
+    t_index pi;
+    {
+        auto start = timer::now();
+        if ( !load_index(pi, entry, opt.idx_file, opt.mmap_load ? &idx_map : nullptr) ) {
+            return 1;
+        }
+        auto stop = timer::now();
+        cout << "# load_time_in_ms = " << duration_cast<chrono::milliseconds>(stop-start).count() << endl;
+        cout << "# mmap_load = " << opt.mmap_load << endl;
+    }
+
+    warmup_core_and_cache();
+
+    int_vector<64> qry;
+    if ( !load_vector_from_file(qry, opt.qry_file, 8) ){
+        cout << "Error: Could not load query file " << opt.qry_file << "." << endl;
+        return 1;
+    } else {
+        cout << "Loaded " << qry.size()<< " queries form file "<<opt.qry_file << endl;
+    }
+
+    if ( opt.check_mode ) {
+        return check(pi, load_keys(opt.hash_file, !opt.keep_duplicates), qry, radius);
+    }
+
+    if(!opt.search_only or opt.print_info) {
+        cout << "# idx_file = " << opt.idx_file << endl;
+        cout << "# hashes = " << pi.size() << endl;
+        cout << "# qry_file = " << opt.qry_file << endl;
+        cout << "# index = " << entry.strategy << endl;
+        cout << "# b = " << (size_t)entry.blocks << endl;
+        cout << "# k = " << (size_t)entry.k << endl;
+        cout << "# radius = " << radius << endl;
+        cout << "# scan_kernel = " << get_scan_kernel().name << endl;
+        cout << "# index_size_in_bytes = " << size_in_bytes(pi) << endl;
+        cout << "# queries = " << qry.size() << endl;
+    }
+
+    if ( opt.threads > 0 ) {
+        thread_pool pool(opt.threads);
+        query_engine<t_index> engine(pi, pool);
+        const query_counts before = query_counters::aggregate();
+        auto stats = engine.run(qry.data(), qry.size(), opt.search_only, radius);
+        const query_counts counts = query_counters::aggregate() - before;
+        cout << "# threads = " << pool.size() << endl;
+        cout << "# queries_per_second = " << stats.queries_per_second() << endl;
+        cout << "# latency_p50_in_us = " << stats.latency_percentile_us(50) << endl;
+        cout << "# latency_p90_in_us = " << stats.latency_percentile_us(90) << endl;
+        cout << "# latency_p99_in_us = " << stats.latency_percentile_us(99) << endl;
+        cout << "# latency_p999_in_us = " << stats.latency_percentile_us(99.9) << endl;
+        cout << "# latency_max_in_us = " << stats.latency_percentile_us(100) << endl;
+        if ( !opt.search_only ) {
+            cout << "# check_cnt_full = " << stats.candidates << endl;
+            cout << "# check_match_full = " << stats.matches << endl;
+            cout << "# check_unique_matches_full = " << stats.unique_matches << endl;
+            cout << "# matches_per_query = " << ((double)stats.matches)/qry.size() << endl;
+            cout << "# unique_matches_per_query = " << ((double)stats.unique_matches)/qry.size() << endl;
+            print_query_counts(counts, qry.size());
+        } else {
+            cout << "# check_cnt_search = " << stats.candidates << endl;
+        }
+        cout << "# candidates_per_query = " << ((double)stats.candidates)/qry.size() << endl;
+        return 0;
+    }
+
+    size_t check_cnt = 0;
+    if ( opt.search_only ) {
+        auto start = timer::now();
+        for (size_t i=0; i<qry.size(); ++i){
+            check_cnt += get<1>(pi.match(qry[i], radius, true));
+        }
+        auto stop = timer::now();
+        cout << "# time_per_search_query_in_us = " << duration_cast<chrono::microseconds>(stop-start).count()/(double)qry.size() << endl;
+        return 0;
+    }
+
+    size_t match_cnt = 0;
+    size_t unique_cnt = 0;
+    {
+        vector<uint64_t> result; // reused, so queries do not allocate
+        const query_counts before = query_counters::aggregate();
+        auto start = timer::now();
+        for (size_t i=0; i<qry.size(); ++i){
+            result.clear();
+            check_cnt += pi.match(qry[i], result, radius);
+            match_cnt += result.size();
+        }
+        auto stop = timer::now();
+        cout << "# time_per_full_query_in_us = " << duration_cast<chrono::microseconds>(stop-start).count()/(double)qry.size() << endl;
+        print_query_counts(query_counters::aggregate() - before, qry.size());
+    }
+    {
+        auto start = timer::now();
+        for (size_t i=0; i<qry.size(); ++i){
+            unique_cnt += get<0>(pi.match_unique(qry[i], radius)).size();
+        }
+        auto stop = timer::now();
+        cout << "# time_per_unique_query_in_us = " << duration_cast<chrono::microseconds>(stop-start).count()/(double)qry.size() << endl;
+    }
+    cout << "# check_cnt_full = " << check_cnt << endl;
+    cout << "# check_match_full = " << match_cnt << endl;
+    cout << "# check_unique_matches_full = " << unique_cnt << endl;
+    cout << "# matches_per_query = " << ((double)match_cnt)/qry.size() << endl;
+    cout << "# unique_matches_per_query = " << ((double)unique_cnt)/qry.size() << endl;
+    cout << "# candidates_per_query = " << ((double)check_cnt)/qry.size() << endl;
+    cout << "# check_cnt_search = " << check_cnt << endl;
+    return 0;
+}
+
+// Prints the header of an index file and optionally checks its section checksums
+int info(const string& idx_file, bool verify) {
+    index_header header;
+    string error;
+    if ( !load_index_header(header, idx_file, error) ) {
+        cout << "ERROR: " << idx_file << " " << error << "." << endl;
+        return 1;
+    }
+    cout << "# idx_file = " << idx_file << endl;
+    cout << "# format_version = " << header.version << endl;
+    cout << "# index = " << header.strategy << endl;
+    cout << "# b = " << header.blocks << endl;
+    cout << "# k = " << header.k << endl;
+    cout << "# block_errors = " << header.block_errors << endl;
+    cout << "# perm_hash = " << hex << header.perm_hash << dec << endl;
+    cout << "# hashes = " << header.keys << endl;
+    cout << "# parallel_construction = " << header.build.parallel << endl;
+    cout << "# build_budget_in_mb = " << header.build.budget_mb << endl;
+    cout << "# index_size_in_bytes = " << header.body_bytes << endl;
+    cout << "# section_bytes = " << header.section_bytes << endl;
+    cout << "# sections = " << header.sections() << endl;
+
+    int ret = 0;
+    const bool supported = dispatch_index(index_registry(), header.strategy, header.k, [&](const auto& entry) {
+        ifstream in(idx_file, ios::binary | ios::ate);
+        if ( !header.validate(entry, in.tellg(), error) ) {
+            cout << "ERROR: " << idx_file << " " << error << "." << endl;
+            ret = 1;
+        }
+    });
+    cout << "# supported = " << supported << endl;
+    if ( !verify ) {
+        return ret;
+    }
+    mmap_file map;
+    if ( !map.open(idx_file) or map.size() < header.file_bytes() ) {
+        cout << "ERROR: " << idx_file << " is truncated." << endl;
+        return 1;
+    }
+    auto bad = header.verify_sections(map);
+    for (auto s : bad) {
+        cout << "ERROR: checksum mismatch in section " << s << " (bytes " << header.body_offset + s*header.section_bytes
+             << " to " << header.body_offset + std::min((s+1)*header.section_bytes, header.body_bytes) << ")." << endl;
+    }
+    cout << "# corrupt_sections = " << bad.size() << endl;
+    return bad.empty() ? ret : 1;
+}
+
+void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " list" << endl;
+    cout << "       " << prog << " build strategy k hash_file idx_file [parallel_construction] [build_budget_mb]" << endl;
+    cout << "       " << prog << " query idx_file query_file [search_only] [print_header_for_search_only] [threads] [mmap_load] [radius]" << endl;
+    cout << "       " << prog << " check idx_file query_file hash_file [radius]" << endl;
+    cout << "       " << prog << " info idx_file [verify]" << endl;
+    cout << " list: prints the strategies and k of all supported index types" << endl;
+    cout << " info: prints the header of an index file" << endl;
+    cout << " verify: 0=No (default); 1=Yes, check the checksums of all sections of the index" << endl;
+    cout << " parallel_construction: 0=No (default); 1=Yes" << endl;
+    cout << " build_budget_mb: 0=load and deduplicate the keys (default); m>0=stream the hash file with m MB of scratch memory; duplicates are kept" << endl;
+    cout << " search_only: 0=No (default); 1=Yes" << endl;
+    cout << " print_header_for_search_only: 0=No (default); 1=Yes" << endl;
+    cout << " threads: 0=serial query loop (default); t>0=query engine with t threads" << endl;
+    cout << " mmap_load: 0=No (default); 1=Yes, map the index file instead of reading it" << endl;
+    cout << " radius: search radius r <= k (default k)" << endl;
+}
+
+int main(int argc, char* argv[]){
+    const string cmd = argc > 1 ? argv[1] : "";
+    int ret = 1;
+
+    if ( cmd == "list" ) {
+        for_each_index(index_registry(), [](const auto& entry) {
+            cout << entry.strategy << " k=" << (size_t)entry.k << " b=" << (size_t)entry.blocks << endl;
+        });
+        return 0;
+    } else if ( cmd == "build" and argc >= 6 ) {
+        build_options opt;
+        const string strategy = argv[2];
+        const uint64_t k = stoull(argv[3]);
+        opt.hash_file = argv[4];
+        opt.idx_file  = argv[5];
+        if ( argc > 6 ) { opt.async     = stoull(argv[6]); }
+        if ( argc > 7 ) { opt.budget_mb = stoull(argv[7]); }
+        if ( !dispatch_index(index_registry(), strategy, k, [&](const auto& entry) { ret = build(entry, opt); }) ) {
+            cout << "ERROR: No index type " << strategy << " with k=" << k << "; see " << argv[0] << " list." << endl;
+            return 1;
+        }
+        return ret;
+    } else if ( cmd == "info" and argc >= 3 ) {
+        return info(argv[2], argc > 3 and stoull(argv[3]));
+    } else if ( (cmd == "query" and argc >= 4) or (cmd == "check" and argc >= 5) ) {
+        query_options opt;
+        opt.idx_file = argv[2];
+        opt.qry_file = argv[3];
+        if ( cmd == "check" ) {
+            opt.check_mode = true;
+            opt.hash_file  = argv[4];
+            if ( argc > 5 ) { opt.radius = stoi(argv[5]); }
+        } else {
+            if ( argc > 4 ) { opt.search_only = stoull(argv[4]); }
+            if ( argc > 5 ) { opt.print_info  = stoull(argv[5]); }
+            if ( argc > 6 ) { opt.threads     = stoull(argv[6]); }
+            if ( argc > 7 ) { opt.mmap_load   = stoull(argv[7]); }
+            if ( argc > 8 ) { opt.radius      = stoi(argv[8]); }
+        }
+        index_header header;
+        string error;
+        if ( !load_index_header(header, opt.idx_file, error) ) {
+            cout << "ERROR: " << opt.idx_file << " " << error << "." << endl;
+            return 1;
+        }
+        opt.keep_duplicates = header.build.budget_mb > 0;
+        if ( !dispatch_index(index_registry(), header.strategy, header.k, [&](const auto& entry) { ret = query(entry, opt); }) ) {
+            cout << "ERROR: " << opt.idx_file << " contains a " << header.strategy << " index with k=" << header.k
+                 << ", which this build does not support." << endl;
+            return 1;
+        }
+        return ret;
+    }
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,87 @@
+/*! Compares bucket_range and bucket_ranges with the two-select formula
+ *  l = select_1(b)-b+1, r = select_1(b+1)-b on directories with empty
+ *  buckets, buckets spanning more than bucket_scan_words words and a large
+ *  or empty last bucket, for sdsl::bit_vector, ef_bucket_vector and
+ *  mappable_bit_vector.
+ */
+#include "multi_idx/bucket_range.hpp"
+#include "multi_idx/ef_bucket_vector.hpp"
+#include "multi_idx/mappable_bit_vector.hpp"
+#include <sdsl/bit_vectors.hpp>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Bucket sizes: mostly empty or small buckets and a few of several cache lines
+vector<uint64_t> random_sizes(size_t buckets, bool large_last, mt19937_64& rng) {
+    vector<uint64_t> sizes(buckets, 0);
+    for (auto& s : sizes) {
+        const uint64_t r = rng() % 100;
+        s = r < 60 ? 0 : r < 97 ? rng() % 8 : 64*bucket_scan_words + rng() % 2000;
+    }
+    sizes.back() = large_last ? 64*bucket_scan_words + 100 : 0;
+    return sizes;
+}
+
+template<typename t_bv>
+size_t check(const string& name, const vector<uint64_t>& sizes) {
+    uint64_t n = 0;
+    for (auto s : sizes) n += s;
+    // a 0 per entry and a 1 behind each bucket, like m_C of the strategies
+    t_bv C(n + sizes.size(), 0);
+    for (uint64_t b=0, pos=0; b < sizes.size(); ++b) {
+        pos += sizes[b];
+        C[pos++] = 1;
+    }
+    typename t_bv::select_1_type C_sel(&C);
+    typename t_bv::rank_1_type C_rank(&C);
+    auto expected = [&](uint64_t b) {
+        return make_pair(b == 0 ? 0 : C_sel(b)-b+1, C_sel(b+1)-b);
+    };
+
+    size_t errors = 0;
+    auto expect = [&](bool ok, const string& what, uint64_t b) {
+        if ( !ok and errors++ == 0 ) {
+            cout << "ERROR: " << name << " " << what << " of bucket " << b << " differs from the two-select formula" << endl;
+        }
+    };
+    for (uint64_t b=0, l=0; b < sizes.size(); l += sizes[b++]) {
+        expect(expected(b) == make_pair(l, l+sizes[b]), "select", b);
+        expect(C_rank(C_sel(b+1)) == b and C_rank(C_sel(b+1)+1) == b+1, "rank", b);
+        expect(bucket_range(C, C_sel, b) == expected(b), "bucket_range", b);
+        const uint64_t last = min<uint64_t>(sizes.size()-1, b + b % 5);
+        expect(bucket_range(C, C_sel, b, last) == make_pair(expected(b).first, expected(last).second), "bucket_range interval", b);
+    }
+    // batches with repeated buckets, which always end with the last bucket
+    mt19937_64 rng(sizes.size());
+    vector<uint64_t> batch;
+    for (size_t i=0; i < 1000; ++i) {
+        batch.push_back(i % 3 == 2 ? batch.back() : rng() % sizes.size());
+    }
+    batch.push_back(sizes.size()-1);
+    vector<pair<uint64_t, uint64_t>> ranges(batch.size());
+    bucket_ranges(C, C_sel, batch.data(), batch.size(), ranges.data());
+    for (size_t j=0; j < batch.size(); ++j) {
+        expect(ranges[j] == expected(batch[j]), "bucket_ranges", batch[j]);
+    }
+    cout << "# " << name << " buckets=" << sizes.size() << " entries=" << n << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(17);
+    size_t errors = 0;
+    for (size_t buckets : {1, 2, 100, 5000, 1<<16}) {
+        for (bool large_last : {false, true}) {
+            const vector<uint64_t> sizes = random_sizes(buckets, large_last, rng);
+            errors += check<sdsl::bit_vector>("bit_vector", sizes);
+            errors += check<ef_bucket_vector>("ef_bucket_vector", sizes);
+            errors += check<mappable_bit_vector>("mappable_bit_vector", sizes);
+        }
+    }
+    return errors > 0;
+}
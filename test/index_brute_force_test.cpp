@@ -0,0 +1,147 @@
+/*! Compares match_unique, count and exists of every index type of the
+ *  registry with a linear scan, for each radius 0..k on a small random key
+ *  set with many near neighbours and on a skewed key set with buckets of
+ *  thousands of keys.
+ *
+ *  Index types with a bucket directory over a splitter universe of 2^32 or
+ *  more (mi_bv_red and mi_bv_split_red for k=3) take more than 1 GB for
+ *  any key set and are skipped, unless the test is run with argument "all".
+ */
+#include "multi_idx/index_registry.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Clusters of keys around random centers, so that every radius has matches
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 8; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+/*! Keys which only differ in 24 fixed bits: 2, 6 and 16 bits of the 16-bit
+ *  blocks [16,32), [32,48) and [48,64). Depending on the block of its splitter
+ *  bits, a permutation gets one bucket with all keys, a few buckets with
+ *  about n/4 keys or many small ones, so that adaptive_buckets_binvector_split
+ *  uses its sub_indexed, clustered and flat layouts.
+ */
+vector<uint64_t> skewed_keys(size_t n, mt19937_64& rng) {
+    vector<uint8_t> positions = {16, 17};
+    for (uint8_t i=32; i < 38; ++i) positions.push_back(i);
+    for (uint8_t i=48; i < 64; ++i) positions.push_back(i);
+    const uint64_t base = rng();
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        uint64_t key = base;
+        for (auto p : positions) {
+            key ^= (rng() & 1ULL) << p;
+        }
+        keys.push_back(key);
+        if ( keys.size() == n ) {
+            sort(keys.begin(), keys.end());
+            keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        }
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// Keys of the set with up to 6 flipped bits and random keys
+vector<uint64_t> random_queries(const vector<uint64_t>& keys, size_t n, mt19937_64& rng) {
+    vector<uint64_t> queries;
+    for (size_t i=0; i < n; ++i) {
+        uint64_t q = i % 8 == 7 ? rng() : keys[rng() % keys.size()];
+        for (size_t e = i % 7; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    return queries;
+}
+
+/*! True if the index type has a bucket directory of 2^splitter_bits bits
+ *  or more. simple_buckets_binsearch binary searches its entries for more
+ *  than 28 splitter bits and has no directory.
+ */
+template<typename t_index>
+struct large_universe {
+    static constexpr bool value = index_traits<t_index>::splitter_bits >= 32;
+};
+
+template<uint8_t t_k, uint8_t t_b>
+struct large_universe<multi_idx<simple_buckets_binsearch, t_k, t_b>> : std::false_type {};
+
+template<uint8_t t_k, uint8_t t_block_errors>
+struct large_universe<multi_idx_red<simple_buckets_binsearch, t_k, t_block_errors>> : std::false_type {};
+
+template<typename t_index>
+size_t check(const char* data, const char* strategy, const vector<uint64_t>& keys, const vector<uint64_t>& queries) {
+    t_index idx(keys);
+    size_t errors = 0;
+    for (int radius=0; radius <= t_index::k; ++radius) {
+        for (auto q : queries) {
+            vector<uint64_t> expected;
+            for (auto key : keys) {
+                if ( (int)sdsl::bits::cnt(key ^ q) <= radius ) {
+                    expected.push_back(key);
+                }
+            }
+            sort(expected.begin(), expected.end());
+            auto res = get<0>(idx.match_unique(q, radius));
+            sort(res.begin(), res.end());
+            const bool ok = res == expected and idx.count(q, radius) == expected.size()
+                            and idx.exists(q, radius) == !expected.empty();
+            if ( !ok ) {
+                if ( errors == 0 ) {
+                    cout << "ERROR: " << data << " " << strategy << " k=" << (size_t)t_index::k << " radius=" << radius
+                         << " query=" << q << ": " << res.size() << " matches instead of " << expected.size() << endl;
+                }
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char* argv[]) {
+    const bool all = argc > 1 and string(argv[1]) == "all";
+    mt19937_64 rng(4711);
+    const vector<uint64_t> keys = random_keys(3000, rng);
+    const vector<uint64_t> queries = random_queries(keys, 200, rng);
+    const vector<uint64_t> skewed = skewed_keys(4000, rng);
+    const vector<uint64_t> skewed_queries = random_queries(skewed, 200, rng);
+    size_t failed = 0;
+    for_each_index(index_registry(), [&](const auto& entry) {
+        typedef typename std::remove_reference<decltype(entry)>::type::index_type index_type;
+        if ( large_universe<index_type>::value and !all ) {
+            cout << "# " << entry.strategy << " k=" << (size_t)entry.k << " skipped: "
+                 << (size_t)index_traits<index_type>::splitter_bits << " splitter bits" << endl;
+            return;
+        }
+        const size_t errors = check<index_type>("random", entry.strategy, keys, queries);
+        const size_t skewed_errors = check<index_type>("skewed", entry.strategy, skewed, skewed_queries);
+        cout << "# " << entry.strategy << " k=" << (size_t)entry.k << " errors=" << errors
+             << " skewed_errors=" << skewed_errors << endl;
+        failed += errors + skewed_errors > 0;
+    });
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
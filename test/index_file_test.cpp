@@ -0,0 +1,117 @@
+/*! Round trip of store_index/load_index, in memory and mapped, and the
+ *  rejection of files of another index type, truncated files, files with a
+ *  corrupt header and headers of other permutations. verify_sections has to
+ *  find exactly the section of a flipped body byte.
+ */
+#include "multi_idx/index_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+typedef multi_idx<simple_buckets_binvector_split<>, 3> index_type;
+
+const string file = "index_file_test.idx";
+const string copy_file = "index_file_test.copy.idx";
+const uint64_t section_bytes = 1ULL << 12;
+
+size_t errors = 0;
+
+void expect(bool ok, const string& what) {
+    if ( !ok ) {
+        cout << "ERROR: " << what << endl;
+        ++errors;
+    }
+}
+
+string read_file(const string& name) {
+    ifstream in(name, std::ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void write_file(const string& name, const string& content) {
+    ofstream out(name, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), content.size());
+}
+
+int main() {
+    mt19937_64 rng(1919);
+    vector<uint64_t> keys(20000);
+    for (auto& key : keys) {
+        key = rng();
+    }
+    const auto entry = register_index<index_type>("mi_bv_split");
+    const index_type idx(keys);
+    index_build_params build;
+    build.parallel = 1;
+    expect(store_index(idx, entry, file, build, section_bytes), "store_index failed");
+
+    // Round trip
+    index_type loaded, mapped;
+    mmap_file map;
+    expect(load_index(loaded, entry, file), "load_index rejected a valid file");
+    expect(load_index(mapped, entry, file, &map), "load_index rejected a valid file to map");
+    expect(mapped.is_mapped(), "index loaded with a map is not mapped");
+    for (size_t i=0; i < 100; ++i) {
+        const uint64_t q = keys[i] ^ (1ULL << (i % 64));
+        expect(loaded.match(q) == idx.match(q) and mapped.match(q) == idx.match(q), "loaded index differs from the stored one");
+    }
+
+    // Header
+    index_header header;
+    string error;
+    expect(load_index_header(header, file, error), "load_index_header failed: " + error);
+    expect(header.keys == keys.size() and header.build.parallel == 1 and header.section_bytes == section_bytes,
+           "header does not record the stored index");
+    expect(header.sections() > 2, "the body should span several sections");
+    expect(header.verify_sections(map).empty(), "verify_sections reports sections of a valid file");
+
+    // Wrong index type: other strategy, other k
+    multi_idx<simple_buckets_binsearch, 3> other_strategy;
+    expect(!load_index(other_strategy, register_index<multi_idx<simple_buckets_binsearch, 3>>("mi_bs"), file),
+           "load_index accepted a file of another strategy");
+    multi_idx<simple_buckets_binvector_split<>, 4> other_k;
+    expect(!load_index(other_k, register_index<multi_idx<simple_buckets_binvector_split<>, 4>>("mi_bv_split"), file),
+           "load_index accepted a file of another k");
+    index_header other_perms = header;
+    other_perms.perm_hash ^= 1;
+    expect(!other_perms.validate(entry, header.file_bytes(), error), "validate accepted other permutations");
+
+    // Truncated file
+    const string content = read_file(file);
+    write_file(copy_file, content.substr(0, content.size() - 8));
+    index_type truncated;
+    expect(!load_index(truncated, entry, copy_file), "load_index accepted a truncated file");
+    expect(!load_index(truncated, entry, copy_file, &map), "load_index accepted a truncated file to map");
+    expect(!load_index_header(header, copy_file, error), "load_index_header accepted a truncated file");
+    write_file(copy_file, content.substr(0, header.body_offset / 2));
+    expect(!load_index(truncated, entry, copy_file), "load_index accepted a file with a truncated header");
+
+    // Corrupt header
+    string corrupt = content;
+    corrupt[16] ^= 1;
+    write_file(copy_file, corrupt);
+    expect(!load_index(truncated, entry, copy_file), "load_index accepted a file with a corrupt header");
+
+    // Corrupt body: the size is right, only verify_sections finds it
+    expect(load_index_header(header, file, error), "load_index_header failed: " + error);
+    const uint64_t bad_section = header.sections() / 2;
+    corrupt = content;
+    corrupt[header.body_offset + bad_section*section_bytes + 7] ^= 0x10;
+    write_file(copy_file, corrupt);
+    mmap_file corrupt_map;
+    expect(corrupt_map.open(copy_file), "could not map the corrupt file");
+    expect(header.verify_sections(corrupt_map) == vector<uint64_t>{bad_section}, "verify_sections did not find the corrupt section");
+
+    std::remove(file.c_str());
+    std::remove(copy_file.c_str());
+    cout << "# errors = " << errors << endl;
+    return errors > 0;
+}
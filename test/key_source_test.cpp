@@ -0,0 +1,123 @@
+/*! Builds indexes from a key file and a payload file with a scratch budget
+ *  far below the size of the keys and compares them with indexes built from
+ *  the same keys in memory. Also checks that the built permutations are
+ *  mapped and that no temporary file is left behind.
+ */
+#include "multi_idx/index_registry.hpp"
+#include "multi_idx/thread_pool.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+const string key_file = "key_source_test.keys";
+const string payload_file = "key_source_test.payloads";
+const uint64_t budget = 1ULL << 16; // the keys take 160 KB
+
+// Clusters of keys around random centers, every tenth key occurs twice
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+            if ( keys.size() % 10 == 0 ) keys.push_back(key);
+        }
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// Stores v as a file of 64-bit integers in plain format
+void store_plain(const vector<uint64_t>& v, const string& file) {
+    ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write((const char*)v.data(), v.size()*sizeof(uint64_t));
+}
+
+// Number of files in the working directory whose name starts with prefix
+size_t files_with_prefix(const string& prefix) {
+    size_t cnt = 0;
+    if ( DIR* dir = opendir(".") ) {
+        while ( dirent* e = readdir(dir) ) {
+            cnt += string(e->d_name).compare(0, prefix.size(), prefix) == 0;
+        }
+        closedir(dir);
+    }
+    return cnt;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& payloads, const vector<uint64_t>& queries) {
+    const key_source source(key_file, payload_file, budget);
+    const t_index expected(keys, payloads);
+    const t_index streamed(source);
+    thread_pool pool(3);
+    const t_index streamed_parallel(source, pool);
+    size_t errors = 0;
+    auto expect = [&](bool ok, const string& what) {
+        if ( !ok and errors++ == 0 ) {
+            cout << "ERROR: " << name << " " << what << endl;
+        }
+    };
+    expect(files_with_prefix(source.temp_prefix()) == 0, "left temporary files");
+    expect(streamed.size() == keys.size() and streamed_parallel.size() == keys.size(), "has the wrong size");
+    expect(streamed.is_mapped() and streamed_parallel.is_mapped(), "is not mapped after a build from a file");
+    auto sorted = [](pair<vector<uint64_t>,uint64_t> res) {
+        sort(res.first.begin(), res.first.end());
+        return res.first;
+    };
+    for (auto q : queries) {
+        const auto res = sorted(expected.match(q));
+        expect(sorted(streamed.match(q)) == res and sorted(streamed_parallel.match(q)) == res, "match differs from the build in memory");
+        const auto pay = sorted(expected.match_payloads(q));
+        expect(sorted(streamed.match_payloads(q)) == pay and sorted(streamed_parallel.match_payloads(q)) == pay,
+               "match_payloads differs from the build in memory");
+    }
+    cout << "# " << name << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(1515);
+    const vector<uint64_t> keys = random_keys(20000, rng);
+    vector<uint64_t> payloads(keys.size());
+    for (size_t i=0; i < keys.size(); ++i) {
+        payloads[i] = i;
+    }
+    store_plain(keys, key_file);
+    store_plain(payloads, payload_file);
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 200; ++i) {
+        uint64_t q = i % 10 == 9 ? rng() : keys[rng() % keys.size()];
+        for (size_t e = i % 5; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    size_t failed = 0;
+    failed += check<multi_idx<simple_buckets_binsearch, 3>>("mi_bs", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_vector, 3>>("mi_vec", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<>, 3>>("mi_bv_split", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef", keys, payloads, queries) > 0;
+    failed += check<multi_idx<xor_buckets_binvector_split<>, 3>>("mi_xor", keys, payloads, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl", keys, payloads, queries) > 0;
+    failed += check<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive", keys, payloads, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red", keys, payloads, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, payloads, queries) > 0;
+    std::remove(key_file.c_str());
+    std::remove(payload_file.c_str());
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
@@ -0,0 +1,99 @@
+/*! Stores an index of each strategy, loads it with load_from_file_mapped
+ *  and checks that the loaded index (and a copy of it) is mapped and
+ *  answers match, match_unique and count like the index in memory.
+ */
+#include "multi_idx/index_registry.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Clusters of keys around random centers, so that the queries have matches
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& queries) {
+    const string file = "mapped_load_test." + name + ".idx";
+    t_index idx(keys);
+    if ( !sdsl::store_to_file(idx, file) ) {
+        cout << "ERROR: " << name << " could not be stored to " << file << endl;
+        return 1;
+    }
+    mmap_file map;
+    t_index mapped;
+    const bool loaded = load_from_file_mapped(mapped, map, file);
+    std::remove(file.c_str()); // the mapping keeps the data
+    size_t errors = 0;
+    auto expect = [&](bool ok, const string& what) {
+        if ( !ok and errors++ == 0 ) {
+            cout << "ERROR: " << name << " " << what << endl;
+        }
+    };
+    expect(loaded, "could not be loaded mapped");
+    if ( !loaded ) return errors;
+    expect(!idx.is_mapped(), "is mapped after construction");
+    expect(mapped.is_mapped(), "is not mapped after load_from_file_mapped");
+    const t_index copy(mapped);
+    expect(copy.is_mapped(), "copy of a mapped index is not mapped");
+    for (auto q : queries) {
+        const auto expected = idx.match(q);
+        expect(mapped.match(q) == expected and copy.match(q) == expected, "match differs from the index in memory");
+        auto unique_expected = get<0>(idx.match_unique(q));
+        auto res = get<0>(mapped.match_unique(q));
+        sort(unique_expected.begin(), unique_expected.end());
+        sort(res.begin(), res.end());
+        expect(res == unique_expected, "match_unique differs from the index in memory");
+        expect(mapped.count(q) == idx.count(q), "count differs from the index in memory");
+    }
+    cout << "# " << name << " bytes=" << map.size() << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(99);
+    const vector<uint64_t> keys = random_keys(5000, rng);
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 300; ++i) {
+        uint64_t q = keys[rng() % keys.size()];
+        for (size_t e = i % 5; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    size_t failed = 0;
+    failed += check<multi_idx<simple_buckets_binsearch, 3>>("mi_bs", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_vector, 3>>("mi_vec", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_unaligned<>, 3>>("mi_bv_unaligned", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<>, 3>>("mi_bv_split", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split_xor<>, 3>>("mi_bv_split_xor", keys, queries) > 0;
+    failed += check<multi_idx<xor_buckets_binvector_split<>, 3>>("mi_xor", keys, queries) > 0;
+    failed += check<multi_idx<triangle_buckets_binvector_split_simd<>, 3>>("mi_tri_simd", keys, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl", keys, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split_threshold<>, 3>>("mi_tricl_thres", keys, queries) > 0;
+    failed += check<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, queries) > 0;
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
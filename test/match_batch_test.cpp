@@ -0,0 +1,103 @@
+/*! Compares match_batch with a match per query for each radius, with keys
+ *  and with payloads, and checks that a reused result_sink starts empty.
+ */
+#include "multi_idx/index_registry.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Clusters of keys around random centers, so that the queries have matches
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& queries) {
+    vector<uint64_t> payloads(keys.size());
+    for (size_t i=0; i < keys.size(); ++i) {
+        payloads[i] = i;
+    }
+    const t_index idx(keys, payloads);
+    size_t errors = 0;
+    result_sink sink;
+    for (int radius=0; radius <= t_index::k; ++radius) {
+        for (bool report_payloads : {false, true}) {
+            idx.match_batch(queries.data(), queries.size(), sink, false, report_payloads, radius);
+            if ( sink.size() != queries.size() ) {
+                cout << "ERROR: " << name << " sink has " << sink.size() << " queries instead of " << queries.size() << endl;
+                return errors+1;
+            }
+            for (size_t i=0; i < queries.size(); ++i) {
+                auto expected = report_payloads ? idx.match_payloads(queries[i], radius) : idx.match(queries[i], radius);
+                vector<uint64_t> res(sink.begin(i), sink.end(i));
+                sort(res.begin(), res.end());
+                sort(expected.first.begin(), expected.first.end());
+                if ( res != expected.first or sink.candidates[i] != expected.second ) {
+                    if ( errors == 0 ) {
+                        cout << "ERROR: " << name << " radius=" << radius << " payloads=" << report_payloads
+                             << " query=" << queries[i] << ": " << res.size() << " matches and "
+                             << sink.candidates[i] << " candidates instead of " << expected.first.size()
+                             << " and " << expected.second << endl;
+                    }
+                    ++errors;
+                }
+            }
+        }
+    }
+    cout << "# " << name << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(1234);
+    const vector<uint64_t> keys = random_keys(5000, rng);
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 300; ++i) {
+        uint64_t q = i % 10 == 9 ? rng() : keys[rng() % keys.size()];
+        for (size_t e = i % 5; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    queries.push_back(queries[0]); // the same query twice in a batch
+    size_t failed = 0;
+    failed += check<multi_idx<simple_buckets_binsearch, 3>>("mi_bs", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<>, 4>>("mi_bv_split", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef", keys, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl", keys, queries) > 0;
+    failed += check<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, queries) > 0;
+
+    // An empty batch leaves no results of the previous batch in the sink
+    result_sink sink;
+    const multi_idx<simple_buckets_binsearch, 3> idx(keys);
+    idx.match_batch(queries.data(), queries.size(), sink);
+    idx.match_batch(queries.data(), 0, sink);
+    if ( sink.size() != 0 or !sink.matches.empty() ) {
+        cout << "ERROR: empty batch left " << sink.matches.size() << " matches in the sink" << endl;
+        ++failed;
+    }
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
@@ -0,0 +1,123 @@
+/*! Compares match(query, out, radius), visit and visit_unique with match
+ *  and match_unique: same keys, order, duplicates and candidates. Also
+ *  checks that match into a reused buffer with enough capacity does not
+ *  allocate.
+ */
+#include "multi_idx/index_registry.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Number of calls of the global operator new
+atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    ++allocations;
+    if ( void* p = malloc(size ? size : 1) ) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Clusters of keys around random centers, so that the queries have matches
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& queries) {
+    const t_index idx(keys);
+    size_t errors = 0;
+    auto expect = [&](bool ok, const string& what, int radius, uint64_t q) {
+        if ( !ok and errors++ == 0 ) {
+            cout << "ERROR: " << name << " " << what << " radius=" << radius << " query=" << q << endl;
+        }
+    };
+    vector<uint64_t> out;
+    out.reserve(keys.size() * 16); // more than any query can report
+    for (int radius=0; radius <= t_index::k; ++radius) {
+        for (auto q : queries) {
+            const auto expected = idx.match(q, radius);
+            out.assign(1, q); // match appends to out
+            const size_t before = allocations;
+            const uint64_t candidates = idx.match(q, out, radius);
+            const size_t allocated = allocations - before;
+            expect(allocated == 0, "match with a buffer allocated", radius, q);
+            expect(candidates == expected.second and out.size() == expected.first.size()+1 and out[0] == q
+                   and equal(expected.first.begin(), expected.first.end(), out.begin()+1),
+                   "match with a buffer differs from match", radius, q);
+
+            vector<uint64_t> visited;
+            expect(idx.visit(q, [&](uint64_t key) { visited.push_back(key); }, radius) == expected.second
+                   and visited == expected.first, "visit differs from match", radius, q);
+
+            const auto unique_expected = idx.match_unique(q, radius);
+            visited.clear();
+            expect(idx.visit_unique(q, [&](uint64_t key) { visited.push_back(key); }, radius) == unique_expected.second
+                   and visited == unique_expected.first, "visit_unique differs from match_unique", radius, q);
+        }
+    }
+    cout << "# " << name << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(1313);
+    const vector<uint64_t> keys = random_keys(5000, rng);
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 200; ++i) {
+        uint64_t q = i % 10 == 9 ? rng() : keys[rng() % keys.size()];
+        for (size_t e = i % 5; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    size_t failed = 0;
+    failed += check<multi_idx<simple_buckets_binsearch, 3>>("mi_bs", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_vector, 3>>("mi_vec", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_unaligned<>, 3>>("mi_bv_unaligned", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<>, 3>>("mi_bv_split", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef", keys, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split_xor<>, 3>>("mi_bv_split_xor", keys, queries) > 0;
+    failed += check<multi_idx<xor_buckets_binvector_split<>, 3>>("mi_xor", keys, queries) > 0;
+    failed += check<multi_idx<triangle_buckets_binvector_split_simd<>, 3>>("mi_tri_simd", keys, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl", keys, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split_threshold<>, 3>>("mi_tricl_thres", keys, queries) > 0;
+    failed += check<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, queries) > 0;
+    failed += check<linear_scan<3>>("linear_scan", keys, queries) > 0;
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
@@ -0,0 +1,106 @@
+/*! Compares match(query, pool, radius) and match_payloads(query, pool, radius)
+ *  of multi_idx_red with the serial match for pools of several sizes, also
+ *  with several request threads sharing one pool.
+ */
+#include "multi_idx/index_registry.hpp"
+#include "multi_idx/thread_pool.hpp"
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Clusters of keys around random centers, so that the queries have matches
+vector<uint64_t> random_keys(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            keys.push_back(key);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+// Matches of the same query and radius, up to order, and the same number of candidates
+bool same(pair<vector<uint64_t>,uint64_t> res, pair<vector<uint64_t>,uint64_t> expected) {
+    sort(res.first.begin(), res.first.end());
+    sort(expected.first.begin(), expected.first.end());
+    return res == expected;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& queries) {
+    vector<uint64_t> payloads(keys.size());
+    for (size_t i=0; i < keys.size(); ++i) {
+        payloads[i] = keys.size()-i;
+    }
+    const t_index idx(keys, payloads);
+    size_t errors = 0;
+    auto expect = [&](bool ok, const string& what, int radius, uint64_t q) {
+        if ( !ok and errors++ == 0 ) {
+            cout << "ERROR: " << name << " " << what << " radius=" << radius << " query=" << q << endl;
+        }
+    };
+    for (size_t threads : {1, 2, 4}) {
+        thread_pool pool(threads);
+        for (int radius=0; radius <= t_index::k; ++radius) {
+            for (auto q : queries) {
+                expect(same(idx.match(q, pool, radius), idx.match(q, radius)), "match differs from the serial match", radius, q);
+                expect(same(idx.match(q, pool, radius, true), idx.match(q, radius, true)), "candidates differ from the serial match", radius, q);
+                expect(same(idx.match_payloads(q, pool, radius), idx.match_payloads(q, radius)), "match_payloads differs from the serial match", radius, q);
+            }
+        }
+    }
+
+    // Request threads which share one pool get the results of their own queries
+    thread_pool pool(4);
+    vector<size_t> thread_errors(4, 0);
+    vector<thread> requests;
+    for (size_t t=0; t < thread_errors.size(); ++t) {
+        requests.emplace_back([&, t]() {
+            for (size_t i=t; i < queries.size(); i += thread_errors.size()) {
+                thread_errors[t] += !same(idx.match(queries[i], pool, t_index::k), idx.match(queries[i]));
+            }
+        });
+    }
+    for (auto& r : requests) {
+        r.join();
+    }
+    for (auto e : thread_errors) {
+        expect(e == 0, "match differs with a shared pool", t_index::k, 0);
+    }
+    cout << "# " << name << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(4242);
+    const vector<uint64_t> keys = random_keys(5000, rng);
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 200; ++i) {
+        uint64_t q = i % 10 == 9 ? rng() : keys[rng() % keys.size()];
+        for (size_t e = i % 6; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    size_t failed = 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 4, 2>>("mi_bs_red2", keys, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, queries) > 0;
+    failed += check<multi_idx_red<adaptive_buckets_binvector_split<>, 4>>("mi_adaptive_red", keys, queries) > 0;
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}
@@ -0,0 +1,115 @@
+/*! Checks that match_payloads reports the payload of every entry within the
+ *  search radius, for keys which occur several times with different
+ *  payloads, also after the index was stored and loaded.
+ */
+#include "multi_idx/index_registry.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace multi_index;
+
+// Clusters of keys around random centers, every fifth key occurs up to four times
+vector<uint64_t> keys_with_duplicates(size_t n, mt19937_64& rng) {
+    vector<uint64_t> keys;
+    while ( keys.size() < n ) {
+        const uint64_t center = rng();
+        for (size_t i=0; i < 16; ++i) {
+            uint64_t key = center;
+            for (size_t e = rng() % 6; e > 0; --e) {
+                key ^= 1ULL << (rng() % 64);
+            }
+            for (size_t c = keys.size() % 5 == 0 ? 1 + rng() % 4 : 1; c > 0; --c) {
+                keys.push_back(key);
+            }
+        }
+    }
+    shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+template<typename t_index>
+size_t check_index(const string& name, const t_index& idx, const vector<uint64_t>& keys,
+                   const vector<uint64_t>& payloads, const vector<uint64_t>& queries) {
+    size_t errors = 0;
+    for (int radius=0; radius <= t_index::k; ++radius) {
+        for (auto q : queries) {
+            vector<uint64_t> expected;
+            for (size_t i=0; i < keys.size(); ++i) {
+                if ( (int)sdsl::bits::cnt(keys[i] ^ q) <= radius ) {
+                    expected.push_back(payloads[i]);
+                }
+            }
+            sort(expected.begin(), expected.end());
+            // match reports an entry once per permutation which finds it
+            auto res = get<0>(idx.match_payloads(q, radius));
+            const size_t reported = res.size();
+            sort(res.begin(), res.end());
+            res.erase(unique(res.begin(), res.end()), res.end());
+            if ( res != expected or reported != get<0>(idx.match(q, radius)).size() ) {
+                if ( errors == 0 ) {
+                    cout << "ERROR: " << name << " radius=" << radius << " query=" << q << ": "
+                         << res.size() << " payloads instead of " << expected.size() << endl;
+                }
+                ++errors;
+            }
+        }
+    }
+    return errors;
+}
+
+template<typename t_index>
+size_t check(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& payloads,
+             const vector<uint64_t>& queries) {
+    const t_index idx(keys, payloads);
+    size_t errors = check_index(name, idx, keys, payloads, queries);
+    const string file = "payload_test." + name + ".idx";
+    t_index loaded;
+    if ( !sdsl::store_to_file(idx, file) or !sdsl::load_from_file(loaded, file) ) {
+        cout << "ERROR: " << name << " could not be stored to and loaded from " << file << endl;
+        ++errors;
+    } else {
+        errors += check_index(name + " (loaded)", loaded, keys, payloads, queries);
+    }
+    std::remove(file.c_str());
+    cout << "# " << name << " errors=" << errors << endl;
+    return errors;
+}
+
+int main() {
+    mt19937_64 rng(808);
+    const vector<uint64_t> keys = keys_with_duplicates(4000, rng);
+    vector<uint64_t> payloads(keys.size());
+    for (size_t i=0; i < keys.size(); ++i) {
+        payloads[i] = 3*i+1;
+    }
+    vector<uint64_t> queries;
+    for (size_t i=0; i < 200; ++i) {
+        uint64_t q = keys[rng() % keys.size()];
+        for (size_t e = i % 5; e > 0; --e) {
+            q ^= 1ULL << (rng() % 64);
+        }
+        queries.push_back(q);
+    }
+    size_t failed = 0;
+    failed += check<multi_idx<simple_buckets_binsearch, 3>>("mi_bs", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_vector, 3>>("mi_vec", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector<>, 3>>("mi_bv", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_unaligned<>, 3>>("mi_bv_unaligned", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<>, 3>>("mi_bv_split", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split<ef_bucket_vector>, 3>>("mi_bv_split_ef", keys, payloads, queries) > 0;
+    failed += check<multi_idx<simple_buckets_binvector_split_xor<>, 3>>("mi_bv_split_xor", keys, payloads, queries) > 0;
+    failed += check<multi_idx<xor_buckets_binvector_split<>, 3>>("mi_xor", keys, payloads, queries) > 0;
+    failed += check<multi_idx<triangle_buckets_binvector_split_simd<>, 3>>("mi_tri_simd", keys, payloads, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split<>, 3>>("mi_tricl", keys, payloads, queries) > 0;
+    failed += check<multi_idx<triangle_clusters_binvector_split_threshold<>, 3>>("mi_tricl_thres", keys, payloads, queries) > 0;
+    failed += check<multi_idx<adaptive_buckets_binvector_split<>, 3>>("mi_adaptive", keys, payloads, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binsearch, 3>>("mi_bs_red", keys, payloads, queries) > 0;
+    failed += check<multi_idx_red<simple_buckets_binvector_split<>, 4>>("mi_bv_split_red", keys, payloads, queries) > 0;
+    cout << "# failed_index_types = " << failed << endl;
+    return failed > 0;
+}